@@ -128,6 +128,13 @@ struct ServerSocketConfig {
    */
   std::chrono::milliseconds connectionIdleTimeout{600000};
 
+  /**
+   * Whether connection activity only timestamps the connection instead of
+   * rescheduling its idle timer. The timer then rearms itself for the
+   * remaining time when it fires. Saves timer churn on chatty connections.
+   */
+  bool lazyIdleTimeout{false};
+
   /**
    * The number of milliseconds a connection can remain alive for (0 = infinity)
    */
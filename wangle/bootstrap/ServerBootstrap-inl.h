@@ -122,6 +122,9 @@ class ServerAcceptor : public Acceptor,
     }
 
     void timeoutExpired() noexcept override {
+      if (lazyIdleTimeout_ && rearmIdleTimeout()) {
+        return;
+      }
       auto ew = folly::make_exception_wrapper<AcceptorException>(
           AcceptorException::ExceptionType::TIMED_OUT, "timeout");
       pipeline_->readException(ew);
@@ -164,13 +167,28 @@ class ServerAcceptor : public Acceptor,
     }
 
     void refreshTimeout() override {
-      resetTimeout();
+      if (lazyIdleTimeout_) {
+        reportActivity();
+      } else {
+        resetTimeout();
+      }
     }
 
     void setNotifyPendingShutdown(bool isEnabled) {
       enableNotifyPendingShutdown_ = isEnabled;
     }
 
+    /**
+     * In lazy mode refreshTimeout() only records the time of the last
+     * activity with reportActivity(). The idle timer is left alone on the
+     * hot path; when it fires it rearms itself for whatever remains of the
+     * idle timeout.
+     */
+    void setLazyIdleTimeout(bool isEnabled) {
+      lazyIdleTimeout_ = isEnabled;
+      reportActivity();
+    }
+
     [[nodiscard]] const folly::SocketAddress& getPeerAddress()
         const noexcept override {
       return peerAddress_;
@@ -180,8 +198,26 @@ class ServerAcceptor : public Acceptor,
     ~ServerConnection() override {
       pipeline_->setPipelineManager(nullptr);
     }
+
+    // Returns true if there was activity within the idle timeout, in which
+    // case the timer has been rescheduled for the remaining time.
+    bool rearmIdleTimeout() {
+      auto manager = getConnectionManager();
+      if (!manager) {
+        return false;
+      }
+      auto timeout = manager->getDefaultTimeout();
+      auto idle = getLastActivityElapsedTime();
+      if (!idle || *idle >= timeout) {
+        return false;
+      }
+      resetTimeoutTo(timeout - *idle);
+      return true;
+    }
+
     typename Pipeline::Ptr pipeline_;
     bool enableNotifyPendingShutdown_{false};
+    bool lazyIdleTimeout_{false};
     folly::SocketAddress peerAddress_;
   };
 
@@ -241,6 +277,7 @@ class ServerAcceptor : public Acceptor,
     auto connection =
         new ServerConnection(std::move(pipeline), *connInfo.clientAddr);
     connection->setNotifyPendingShutdown(enableNotifyPendingShutdown_);
+    connection->setLazyIdleTimeout(accConfig_->lazyIdleTimeout);
     Acceptor::addConnection(connection);
     connection->init();
   }
@@ -17,6 +17,7 @@
 #include <latch>
 
 #include "wangle/bootstrap/ClientBootstrap.h"
+#include "wangle/acceptor/ConnectionManager.h"
 #include "wangle/bootstrap/ServerBootstrap.h"
 #include "wangle/channel/Handler.h"
 
@@ -490,3 +491,61 @@ TEST(Bootstrap, ConcurrentStopSharedPool) {
     t2.join();
   }
 }
+
+namespace {
+
+class IdleTimeoutRecorder : public BytesToBytesHandler {
+ public:
+  void readException(Context*, exception_wrapper ew) override {
+    EXPECT_TRUE(ew.with_exception<AcceptorException>([](auto& ex) {
+      EXPECT_EQ(AcceptorException::ExceptionType::TIMED_OUT, ex.getType());
+    }));
+    timedOutAt = std::chrono::steady_clock::now();
+  }
+
+  Optional<std::chrono::steady_clock::time_point> timedOutAt;
+};
+
+using ServerConnection = ServerAcceptor<BytesPipeline>::ServerConnection;
+
+// Runs a ServerConnection with a lazy idle timeout, calling refreshTimeout()
+// after activityAfter if set, and returns how long it took to time out.
+std::chrono::milliseconds lazyIdleTimeout(
+    std::chrono::milliseconds timeout,
+    Optional<std::chrono::milliseconds> activityAfter) {
+  EventBase evb;
+  auto manager = ConnectionManager::makeUnique(&evb, timeout);
+  IdleTimeoutRecorder recorder;
+  auto pipeline = BytesPipeline::create();
+  pipeline->addBack(&recorder).finalize();
+  auto conn = new ServerConnection(pipeline);
+  conn->setLazyIdleTimeout(true);
+  manager->addConnection(conn, true);
+
+  const auto start = std::chrono::steady_clock::now();
+  if (activityAfter) {
+    evb.runAfterDelay([&] { conn->refreshTimeout(); }, activityAfter->count());
+  }
+  while (!recorder.timedOutAt) {
+    evb.loopOnce();
+  }
+  conn->destroy();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      *recorder.timedOutAt - start);
+}
+
+} // namespace
+
+TEST(ServerConnection, LazyIdleTimeoutRearmsAfterActivity) {
+  // Activity halfway through pushes the timeout back by as much, instead of
+  // closing the connection when the first timer fires.
+  auto elapsed = lazyIdleTimeout(
+      std::chrono::milliseconds(200), std::chrono::milliseconds(100));
+  EXPECT_GE(elapsed.count(), 290);
+}
+
+TEST(ServerConnection, LazyIdleTimeoutClosesIdleConnection) {
+  auto elapsed = lazyIdleTimeout(std::chrono::milliseconds(200), none);
+  EXPECT_GE(elapsed.count(), 190);
+  EXPECT_LT(elapsed.count(), 290);
+}
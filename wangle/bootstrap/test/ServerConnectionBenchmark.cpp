@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <wangle/acceptor/ConnectionManager.h>
+#include <wangle/bootstrap/ServerBootstrap.h>
+
+using namespace wangle;
+
+namespace {
+
+using ServerConnection = ServerAcceptor<DefaultPipeline>::ServerConnection;
+
+// Every read and write on a ServerConnection's pipeline ends up in
+// refreshTimeout(), so this measures the per-I/O idle timer overhead.
+void refreshTimeout(size_t iters, bool lazy) {
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb;
+  auto manager =
+      ConnectionManager::makeUnique(&evb, std::chrono::milliseconds(60000));
+  auto conn = new ServerConnection(DefaultPipeline::create());
+  conn->setLazyIdleTimeout(lazy);
+  manager->addConnection(conn, true);
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    conn->refreshTimeout();
+  }
+
+  suspender.rehire();
+  conn->destroy();
+}
+
+} // namespace
+
+BENCHMARK(EagerIdleTimeoutRefresh, iters) {
+  refreshTimeout(iters, false);
+}
+
+BENCHMARK_RELATIVE(LazyIdleTimeoutRefresh, iters) {
+  refreshTimeout(iters, true);
+}
+
+int main(int argc, char** argv) {
+  const folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
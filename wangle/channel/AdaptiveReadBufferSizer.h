@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <wangle/util/Logging.h>
+
+namespace wangle {
+
+/*
+ * AdaptiveReadBufferSizer picks the size of the next read buffer from the
+ * lengths of recent reads, modeled after netty's AdaptiveRecvByteBufAllocator.
+ * The size doubles as soon as a read fills the whole buffer it was given and
+ * halves after two consecutive reads that would have fit in half of it. It
+ * always stays within [minSize, maxSize].
+ */
+class AdaptiveReadBufferSizer {
+ public:
+  AdaptiveReadBufferSizer(
+      uint64_t minSize,
+      uint64_t maxSize,
+      uint64_t initialSize = 2048)
+      : minSize_(minSize),
+        maxSize_(maxSize),
+        size_(std::clamp(initialSize, minSize, maxSize)) {
+    WANGLE_CHECK_GT(minSize, 0);
+    WANGLE_CHECK_LE(minSize, maxSize);
+  }
+
+  uint64_t getMaxSize() const {
+    return maxSize_;
+  }
+
+  uint64_t getAllocationSize() const {
+    return size_;
+  }
+
+  /*
+   * Record a read of len bytes into a buffer that had bufferLen bytes
+   * available.
+   */
+  void record(size_t len, size_t bufferLen) {
+    if (len >= bufferLen) {
+      size_ = std::min(size_ * 2, maxSize_);
+      decreaseNow_ = false;
+    } else if (len <= size_ / 2) {
+      if (decreaseNow_) {
+        size_ = std::max(size_ / 2, minSize_);
+        decreaseNow_ = false;
+      } else {
+        decreaseNow_ = true;
+      }
+    } else {
+      decreaseNow_ = false;
+    }
+  }
+
+ private:
+  uint64_t minSize_;
+  uint64_t maxSize_;
+  uint64_t size_;
+  bool decreaseNow_{false};
+};
+
+/*
+ * Counters for the reads done by a transport handler. Every
+ * readDataAvailable() callback corresponds to one read from the socket.
+ */
+struct ReadBufferStats {
+  uint64_t numReads{0};
+  uint64_t bytesRead{0};
+
+  double averageReadSize() const {
+    return numReads ? static_cast<double>(bytesRead) / numReads : 0.0;
+  }
+
+  double readsPerByte() const {
+    return bytesRead ? static_cast<double>(numReads) / bytesRead : 0.0;
+  }
+};
+
+} // namespace wangle
@@ -16,11 +16,19 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include <folly/Indestructible.h>
+#include <folly/IntrusiveList.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseLocal.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <wangle/channel/AdaptiveReadBufferSizer.h>
 #include <wangle/channel/Handler.h>
 #include <wangle/util/Logging.h>
 
@@ -33,32 +41,50 @@ using THandlerAdapter =
 // This handler may only be used in a single Pipeline
 template <typename R>
 class TAsyncSocketHandler : public THandlerAdapter<R>,
-                            public folly::AsyncTransport::ReadCallback {
+                            public folly::AsyncTransport::ReadCallback,
+                            public ReadFlowController {
   using Context = typename THandlerAdapter<R>::Context;
 
  public:
   explicit TAsyncSocketHandler(std::shared_ptr<folly::AsyncTransport> socket)
-      : socket_(std::move(socket)) {}
+      : writeCallbacks_(std::make_unique<WriteCallbackPool>()),
+        socket_(std::move(socket)) {}
 
   TAsyncSocketHandler(TAsyncSocketHandler&&) = default;
 
   ~TAsyncSocketHandler() override {
+    if (writeCallbacks_) {
+      writeCallbacks_->setHandler(nullptr);
+    }
     detachReadCallback();
 
     if (socket_) {
       auto evb = socket_->getEventBase();
       if (evb) {
+        // Dropping readControl_ on the EventBase thread orders this against
+        // callbacks posted by readEnabledChanged().
         evb->runImmediatelyOrRunInEventBaseThreadAndWait(
-            [s = std::move(socket_)]() mutable { s.reset(); });
+            [s = std::move(socket_),
+             readControl = std::move(readControl_)]() mutable {
+              s.reset();
+              readControl.reset();
+            });
       }
     }
   }
 
   void attachReadCallback() {
+    auto ctx = this->getContext();
+    if (ctx && !ctx->getPipeline()->isReadEnabled()) {
+      // Reads were paused through PipelineBase::setReadEnabled(false).
+      readPaused_ = true;
+      return;
+    }
     socket_->setReadCB(socket_->good() ? this : nullptr);
   }
 
   void detachReadCallback() {
+    readPaused_ = false;
     if (socket_ && socket_->getReadCallback() == this) {
       socket_->setReadCB(nullptr);
     }
@@ -72,17 +98,20 @@ class TAsyncSocketHandler : public THandlerAdapter<R>,
   void attachEventBase(folly::EventBase* eventBase) {
     if (eventBase && !socket_->getEventBase()) {
       socket_->attachEventBase(eventBase);
+      readControl_->evb = eventBase;
     }
   }
 
   void detachEventBase() {
     detachReadCallback();
     if (socket_->getEventBase()) {
+      readControl_->evb = nullptr;
       socket_->detachEventBase();
     }
   }
 
   void transportActive(Context* ctx) override {
+    readControl_->evb = socket_->getEventBase();
     ctx->getPipeline()->setTransport(socket_);
     attachReadCallback();
     firedInactive_ = false;
@@ -96,28 +125,154 @@ class TAsyncSocketHandler : public THandlerAdapter<R>,
     ctx->getPipeline()->setTransport(nullptr);
   }
 
-  void detachPipeline(Context*) override {
+  void attachPipeline(Context* ctx) override {
+    writeCallbacks_->setHandler(this);
+    ctx->getPipeline()->setReadFlowController(this);
+  }
+
+  void detachPipeline(Context* ctx) override {
+    writeCallbacks_->setHandler(nullptr);
+    if (ctx->getPipeline()->getReadFlowController() == this) {
+      ctx->getPipeline()->setReadFlowController(nullptr);
+    }
     detachReadCallback();
   }
 
+  // ReadFlowController override. May be called from any thread, so only
+  // readControl_ is touched here; the rest happens on the EventBase.
+  void readEnabledChanged() override {
+    auto evb = readControl_->evb.load(std::memory_order_acquire);
+    if (!evb) {
+      // Not active yet; transportActive() applies the read enabled state.
+      return;
+    }
+    evb->runImmediatelyOrRunInEventBaseThread(
+        [this, readControl = std::weak_ptr<ReadControl>(readControl_)]() {
+          if (!readControl.expired()) {
+            updateReadCallback();
+          }
+        });
+  }
+
+  /**
+   * In fire-and-forget mode write() does not create a Promise/Future pair.
+   * The returned Future is empty (invalid) and must not be waited on or
+   * chained; write errors are instead delivered inbound through
+   * readException(). Only enable this if no handler in the pipeline consumes
+   * the Future returned by fireWrite().
+   */
+  void setFireAndForgetWrites(bool enabled) {
+    fireAndForgetWrites_ = enabled;
+  }
+
+  bool getFireAndForgetWrites() const {
+    return fireAndForgetWrites_;
+  }
+
+  // Completed write callbacks kept for reuse by later writes.
+  size_t getNumFreeWriteCallbacks() const {
+    return writeCallbacks_->numFree();
+  }
+
+  /**
+   * Size read buffers from recent read lengths within [minSize, maxSize]
+   * instead of the pipeline's fixed read buffer settings.
+   */
+  void setAdaptiveReadBufferSizing(uint64_t minSize, uint64_t maxSize) {
+    auto ctx = this->getContext();
+    readBufferSizer_.emplace(
+        minSize,
+        maxSize,
+        ctx ? ctx->getReadBufferSettings().second : minSize);
+  }
+
+  /**
+   * Largest read buffer to preallocate for the rest of a frame the decoder
+   * is waiting on, see PipelineBase::getReadBytesExpected(). The frame
+   * length comes from the peer, so this bounds what a header alone can make
+   * every connection allocate; larger frames are read into several buffers.
+   * With adaptive read buffer sizing, its maxSize is the bound instead.
+   */
+  void setMaxReadBytesExpected(uint64_t maxBytes) {
+    maxReadBytesExpected_ = maxBytes;
+  }
+
+  const ReadBufferStats& getReadBufferStats() const {
+    return readBufferStats_;
+  }
+
+  /**
+   * Like SSL_MODE_RELEASE_BUFFERS: read into a scratch buffer shared by all
+   * connections on the EventBase and copy out only the bytes received,
+   * instead of preallocating a read buffer per connection that then sits
+   * mostly empty while the connection is idle. Only reads on an idle
+   * connection go into the scratch buffer: once a read fills it, reads go
+   * back to preallocated buffers until one is short, so a busy connection
+   * does not pay for the copy. After a short read, what the pipeline left
+   * queued, such as the start of a frame, is copied into a buffer of its
+   * own size if that releases enough unused capacity.
+   */
+  void setReleaseIdleReadBuffers(bool enabled) {
+    releaseIdleReadBuffers_ = enabled;
+  }
+
+  // Bytes allocated by the read queue, including unused tailroom.
+  size_t getReadBufferCapacity() const {
+    size_t capacity = 0;
+    if (auto head = bufQueue_.front()) {
+      auto buf = head;
+      do {
+        capacity += buf->capacity();
+        buf = buf->next();
+      } while (buf != head);
+    }
+    return capacity;
+  }
+
+  /**
+   * Accept whole buffers from the transport through readBufferAvailable().
+   * Transports that already own the bytes they deliver (fizz, kTLS, io_uring
+   * provided buffers) then append them to the read queue without a copy.
+   * Off by default: a plain AsyncSocket would allocate a maxBufferSize()
+   * buffer per read for a movable callback.
+   */
+  void setMovableReadBuffers(bool enabled) {
+    movableReadBuffers_ = enabled;
+  }
+
   folly::Future<folly::Unit> write(
       Context* ctx,
       std::unique_ptr<folly::IOBuf> buf) override {
     refreshTimeout();
+    const auto flags =
+        ctx->getWriteFlags() | ctx->getPipeline()->takeNextWriteFlags();
     if (UNLIKELY(!buf)) {
       return folly::makeFuture();
     }
 
     if (!socket_->good()) {
       WANGLE_VLOG(5) << "socket is closed in write()";
-      return folly::makeFuture<folly::Unit>(folly::AsyncSocketException(
+      folly::AsyncSocketException ex(
           folly::AsyncSocketException::AsyncSocketExceptionType::NOT_OPEN,
-          "socket is closed in write()"));
+          "socket is closed in write()");
+      if (fireAndForgetWrites_) {
+        ctx->fireReadException(
+            folly::make_exception_wrapper<folly::AsyncSocketException>(ex));
+        return folly::Future<folly::Unit>::makeEmpty();
+      }
+      return folly::makeFuture<folly::Unit>(std::move(ex));
     }
 
-    auto cb = new WriteCallback();
+    auto cb = writeCallbacks_->acquire();
+    if (fireAndForgetWrites_) {
+      socket_->writeChain(cb, std::move(buf), flags);
+      updateWritability();
+      return folly::Future<folly::Unit>::makeEmpty();
+    }
+    cb->promise_ = folly::Promise<folly::Unit>();
     auto future = cb->promise_.getFuture();
-    socket_->writeChain(cb, std::move(buf), ctx->getWriteFlags());
+    socket_->writeChain(cb, std::move(buf), flags);
+    updateWritability();
     return future;
   }
 
@@ -145,16 +300,82 @@ class TAsyncSocketHandler : public THandlerAdapter<R>,
   }
 
   void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
-    const auto readBufferSettings = this->getContext()->getReadBufferSettings();
+    if (releaseIdleReadBuffers_ && idle_) {
+      auto& scratch =
+          scratchReadBuffer().getOrCreate(*socket_->getEventBase());
+      *bufReturn = scratch.data();
+      *lenReturn = scratch.size();
+      readBufferLen_ = scratch.size();
+      readingIntoScratch_ = true;
+      return;
+    }
+    readingIntoScratch_ = false;
+
+    auto readBufferSettings = this->getContext()->getReadBufferSettings();
+    auto maxReadBytesExpected = maxReadBytesExpected_;
+    if (readBufferSizer_) {
+      const auto size = readBufferSizer_->getAllocationSize();
+      readBufferSettings = std::make_pair(size, size);
+      maxReadBytesExpected = readBufferSizer_->getMaxSize();
+    }
+    // Make room for the rest of a frame the decoder is waiting on, so that
+    // it arrives in one buffer rather than a chain of small ones.
+    const auto expected = std::min(
+        this->getContext()->getPipeline()->getReadBytesExpected(),
+        maxReadBytesExpected);
+    if (expected > readBufferSettings.first) {
+      readBufferSettings = std::make_pair(
+          expected, std::max(expected, readBufferSettings.second));
+    }
     const auto ret = bufQueue_.preallocate(
         readBufferSettings.first, readBufferSettings.second);
     *bufReturn = ret.first;
     *lenReturn = ret.second;
+    readBufferLen_ = ret.second;
   }
 
   void readDataAvailable(size_t len) noexcept override {
     refreshTimeout();
-    bufQueue_.postallocate(len);
+    ++readBufferStats_.numReads;
+    readBufferStats_.bytesRead += len;
+    if (readBufferSizer_) {
+      readBufferSizer_->record(len, readBufferLen_);
+    }
+    idle_ = len < readBufferLen_;
+    if (readingIntoScratch_) {
+      readingIntoScratch_ = false;
+      // Pack small reads into the tail buffer rather than chaining them.
+      bufQueue_.append(
+          folly::IOBuf::copyBuffer(
+              scratchReadBuffer().getOrCreate(*socket_->getEventBase()).data(),
+              len),
+          true);
+    } else {
+      bufQueue_.postallocate(len);
+    }
+    auto ctx = this->getContext();
+    if (!releaseIdleReadBuffers_) {
+      ctx->fireRead(bufQueue_);
+      return;
+    }
+    // Keeps this handler alive to look at the queue after the read.
+    auto pipeline = ctx->getPipelineShared();
+    ctx->fireRead(bufQueue_);
+    if (idle_) {
+      releaseReadTailroom();
+    }
+  }
+
+  bool isBufferMovable() noexcept override {
+    return movableReadBuffers_;
+  }
+
+  void readBufferAvailable(
+      std::unique_ptr<folly::IOBuf> buf) noexcept override {
+    refreshTimeout();
+    ++readBufferStats_.numReads;
+    readBufferStats_.bytesRead += buf->computeChainDataLength();
+    bufQueue_.append(std::move(buf));
     this->getContext()->fireRead(bufQueue_);
   }
 
@@ -175,6 +396,77 @@ class TAsyncSocketHandler : public THandlerAdapter<R>,
     }
   }
 
+  // Applies the pipeline's read enabled state; only a read callback that was
+  // detached for pausing gets reattached.
+  void updateReadCallback() {
+    auto ctx = this->getContext();
+    if (!ctx || !socket_) {
+      return;
+    }
+    if (ctx->getPipeline()->isReadEnabled()) {
+      if (readPaused_) {
+        readPaused_ = false;
+        attachReadCallback();
+      }
+    } else if (socket_->getReadCallback() == this) {
+      socket_->setReadCB(nullptr);
+      readPaused_ = true;
+    }
+  }
+
+  // Copies what is left in the read queue into a buffer of its own size,
+  // unless that would copy more bytes than it releases.
+  void releaseReadTailroom() {
+    const size_t length = bufQueue_.chainLength();
+    const size_t unused = getReadBufferCapacity() - length;
+    if (unused < kMinReleasedTailroom || unused <= length) {
+      return;
+    }
+    auto leftover = bufQueue_.move();
+    if (length == 0) {
+      return;
+    }
+    auto compact = folly::IOBuf::create(length);
+    for (auto range : *leftover) {
+      std::memcpy(compact->writableTail(), range.data(), range.size());
+      compact->append(range.size());
+    }
+    bufQueue_.append(std::move(compact));
+  }
+
+  static constexpr size_t kMinReleasedTailroom = 1024;
+
+  static constexpr size_t kScratchReadBufferSize = 64 * 1024;
+
+  using ScratchReadBuffer = std::array<uint8_t, kScratchReadBufferSize>;
+
+  static folly::EventBaseLocal<ScratchReadBuffer>& scratchReadBuffer() {
+    static folly::Indestructible<folly::EventBaseLocal<ScratchReadBuffer>>
+        scratch;
+    return *scratch;
+  }
+
+  // Compares the bytes buffered in the transport against the pipeline's
+  // write buffer watermarks and fires writabilityChanged() on a transition.
+  void updateWritability() {
+    auto ctx = this->getContext();
+    if (!ctx || !socket_) {
+      return;
+    }
+    const auto watermarks = ctx->getPipeline()->getWriteBufferWatermarks();
+    if (watermarks.second == 0) {
+      return;
+    }
+    const auto buffered = socket_->getAppBytesBuffered();
+    if (writable_ && buffered > watermarks.second) {
+      writable_ = false;
+      ctx->fireWritabilityChanged(false);
+    } else if (!writable_ && buffered <= watermarks.first) {
+      writable_ = true;
+      ctx->fireWritabilityChanged(true);
+    }
+  }
+
   folly::Future<folly::Unit> shutdown(Context* ctx, bool closeWithReset) {
     if (socket_) {
       detachReadCallback();
@@ -191,28 +483,145 @@ class TAsyncSocketHandler : public THandlerAdapter<R>,
     return folly::makeFuture();
   }
 
+  class WriteCallbackPool;
+
+  // WriteCallbacks are recycled through a per-handler WriteCallbackPool.
+  // A callback that completes after its pool is gone deletes itself.
   class WriteCallback : private folly::AsyncTransport::WriteCallback {
     void writeSuccess() noexcept override {
-      promise_.setValue();
-      delete this;
+      if (promise_.valid()) {
+        promise_.setValue();
+        promise_ = folly::Promise<folly::Unit>::makeEmpty();
+      }
+      auto pool = pool_;
+      release();
+      if (pool) {
+        pool->onWriteSuccess();
+      }
     }
 
     void writeErr(
         size_t /* bytesWritten */,
         const folly::AsyncSocketException& ex) noexcept override {
-      promise_.setException(ex);
-      delete this;
+      if (promise_.valid()) {
+        promise_.setException(ex);
+        promise_ = folly::Promise<folly::Unit>::makeEmpty();
+      } else if (pool_) {
+        pool_->onWriteErr(ex);
+      }
+      release();
+    }
+
+    void release() {
+      if (pool_) {
+        pool_->release(this);
+      } else {
+        delete this;
+      }
     }
 
    private:
     friend class TAsyncSocketHandler;
-    folly::Promise<folly::Unit> promise_;
+    friend class WriteCallbackPool;
+    folly::Promise<folly::Unit> promise_{
+        folly::Promise<folly::Unit>::makeEmpty()};
+    WriteCallbackPool* pool_{nullptr};
+    folly::IntrusiveListHook hook_;
+  };
+
+  class WriteCallbackPool {
+   public:
+    ~WriteCallbackPool() {
+      // In-flight callbacks are owned by the transport until it calls them
+      // back; orphan them so they delete themselves.
+      inflight_.clear_and_dispose(
+          [](WriteCallback* cb) { cb->pool_ = nullptr; });
+      free_.clear_and_dispose([](WriteCallback* cb) { delete cb; });
+    }
+
+    void setHandler(TAsyncSocketHandler* handler) {
+      handler_ = handler;
+    }
+
+    WriteCallback* acquire() {
+      WriteCallback* cb;
+      if (free_.empty()) {
+        cb = new WriteCallback();
+        cb->pool_ = this;
+      } else {
+        cb = &free_.front();
+        free_.pop_front();
+        --numFree_;
+      }
+      inflight_.push_back(*cb);
+      return cb;
+    }
+
+    void release(WriteCallback* cb) {
+      cb->hook_.unlink();
+      if (numFree_ < kMaxFreeWriteCallbacks) {
+        free_.push_front(*cb);
+        ++numFree_;
+      } else {
+        delete cb;
+      }
+    }
+
+    size_t numFree() const {
+      return numFree_;
+    }
+
+    void onWriteSuccess() {
+      if (handler_) {
+        handler_->updateWritability();
+      }
+    }
+
+    void onWriteErr(const folly::AsyncSocketException& ex) {
+      auto ctx = handler_ ? handler_->getContext() : nullptr;
+      if (ctx) {
+        ctx->fireReadException(
+            folly::make_exception_wrapper<folly::AsyncSocketException>(ex));
+      }
+    }
+
+   private:
+    static constexpr size_t kMaxFreeWriteCallbacks = 16;
+
+    using List = folly::IntrusiveList<WriteCallback, &WriteCallback::hook_>;
+    List free_;
+    List inflight_;
+    size_t numFree_{0};
+    TAsyncSocketHandler* handler_{nullptr};
+  };
+
+  // Shared with callbacks posted by readEnabledChanged(), which check that it
+  // is still alive before touching the handler.
+  struct ReadControl {
+    // The transport's EventBase, set on that EventBase's thread.
+    std::atomic<folly::EventBase*> evb{nullptr};
   };
 
   R bufQueue_{folly::IOBufQueue::cacheChainLength()};
+  folly::Optional<AdaptiveReadBufferSizer> readBufferSizer_;
+  ReadBufferStats readBufferStats_;
+  size_t readBufferLen_{0};
+  uint64_t maxReadBytesExpected_{256 * 1024};
+  bool releaseIdleReadBuffers_{false};
+  bool readingIntoScratch_{false};
+  // Whether the last read was short of its buffer.
+  bool idle_{true};
+  bool movableReadBuffers_{false};
+  // Declared before socket_ so that writes failed while the socket is torn
+  // down can still return their callbacks to the pool.
+  std::unique_ptr<WriteCallbackPool> writeCallbacks_;
   std::shared_ptr<folly::AsyncTransport> socket_{nullptr};
+  std::shared_ptr<ReadControl> readControl_{std::make_shared<ReadControl>()};
   bool firedInactive_{false};
   bool pipelineDeleted_{false};
+  bool fireAndForgetWrites_{false};
+  bool writable_{true};
+  bool readPaused_{false};
 };
 
 using AsyncSocketHandler = TAsyncSocketHandler<folly::IOBufQueue>;
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <folly/AtomicIntrusiveLinkedList.h>
 #include <folly/futures/Future.h>
 #include <wangle/channel/Handler.h>
 #include <wangle/util/Logging.h>
@@ -49,4 +50,122 @@ class EventBaseHandler : public OutboundBytesToBytesHandler {
   }
 };
 
+/*
+ * AsyncEventBaseHandler is a non-blocking alternative to EventBaseHandler.
+ * Writes from other threads are pushed onto a lock-free MPSC queue and the
+ * calling thread returns immediately. The transport's EventBase drains all
+ * pending buffers in one callback and hands them to the next handler as a
+ * single chained write. The returned Future completes once that write does,
+ * or once it is handed off if the next handler returns an empty Future, as
+ * AsyncSocketHandler does for fire-and-forget writes.
+ *
+ * Writes issued on the EventBase thread while nothing is queued bypass the
+ * queue.
+ *
+ * This handler may only be used in a single Pipeline.
+ */
+class AsyncEventBaseHandler : public OutboundBytesToBytesHandler {
+ public:
+  ~AsyncEventBaseHandler() override {
+    pending_.sweep([](PendingWrite* write) { delete write; });
+  }
+
+  folly::Future<folly::Unit> write(
+      Context* ctx,
+      std::unique_ptr<folly::IOBuf> buf) override {
+    if (!buf) {
+      return folly::makeFuture();
+    }
+    auto evb = getEventBase(ctx);
+    if (evb->isInEventBaseThread() && pending_.empty()) {
+      return ctx->fireWrite(std::move(buf));
+    }
+
+    auto write = new PendingWrite(std::move(buf));
+    auto future = write->promise.getFuture();
+    if (pending_.insertHead(write)) {
+      // The queue was empty, so no drain is scheduled yet.
+      evb->runInEventBaseThread(
+          [this, ctx, pipeline = ctx->getPipelineShared()]() {
+            drain(ctx);
+          });
+    }
+    return future;
+  }
+
+  folly::Future<folly::Unit> close(Context* ctx) override {
+    auto evb = getEventBase(ctx);
+    if (evb->isInEventBaseThread()) {
+      drain(ctx);
+      return ctx->fireClose();
+    }
+
+    folly::Promise<folly::Unit> promise;
+    auto future = promise.getFuture();
+    evb->runInEventBaseThread([this,
+                               ctx,
+                               pipeline = ctx->getPipelineShared(),
+                               promise = std::move(promise)]() mutable {
+      drain(ctx);
+      ctx->fireClose().thenTry(
+          [promise = std::move(promise)](folly::Try<folly::Unit> t) mutable {
+            promise.setTry(std::move(t));
+          });
+    });
+    return future;
+  }
+
+ private:
+  struct PendingWrite {
+    explicit PendingWrite(std::unique_ptr<folly::IOBuf> b)
+        : buf(std::move(b)) {}
+
+    std::unique_ptr<folly::IOBuf> buf;
+    folly::Promise<folly::Unit> promise;
+    folly::AtomicIntrusiveLinkedListHook<PendingWrite> hook;
+  };
+
+  static folly::EventBase* getEventBase(Context* ctx) {
+    WANGLE_DCHECK(ctx->getTransport());
+    WANGLE_DCHECK(ctx->getTransport()->getEventBase());
+    return ctx->getTransport()->getEventBase();
+  }
+
+  void drain(Context* ctx) {
+    std::unique_ptr<folly::IOBuf> sends;
+    std::vector<folly::Promise<folly::Unit>> promises;
+    // sweep() visits the writes in the order they were queued.
+    pending_.sweep([&](PendingWrite* write) {
+      if (sends) {
+        sends->prependChain(std::move(write->buf));
+      } else {
+        sends = std::move(write->buf);
+      }
+      promises.push_back(std::move(write->promise));
+      delete write;
+    });
+    if (!sends) {
+      return;
+    }
+
+    auto future = ctx->fireWrite(std::move(sends));
+    if (!future.valid()) {
+      // A fire-and-forget transport handler reports write errors inbound
+      // instead.
+      for (auto& promise : promises) {
+        promise.setValue();
+      }
+      return;
+    }
+    std::move(future).thenTry([promises = std::move(promises)](
+                                  folly::Try<folly::Unit> t) mutable {
+      for (auto& promise : promises) {
+        promise.setTry(folly::Try<folly::Unit>(t));
+      }
+    });
+  }
+
+  folly::AtomicIntrusiveLinkedList<PendingWrite, &PendingWrite::hook> pending_;
+};
+
 } // namespace wangle
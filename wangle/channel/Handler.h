@@ -71,6 +71,18 @@ class Handler : public HandlerBase<HandlerContext<Rout, Wout>> {
   virtual void transportInactive(Context* ctx) {
     ctx->fireTransportInactive();
   }
+  // Fired when the transport's buffered outbound bytes cross the pipeline's
+  // write buffer watermarks. See PipelineBase::setWriteBufferWatermarks().
+  virtual void writabilityChanged(Context* ctx, bool writable) {
+    ctx->fireWritabilityChanged(writable);
+  }
+  // Receives the messages of a fireReadBatch(). By default they are read()
+  // one at a time.
+  virtual void readBatch(Context* ctx, ReadBatch<Rin>& msgs) {
+    for (auto& msg : msgs) {
+      read(ctx, std::forward<Rin>(msg));
+    }
+  }
 
   virtual folly::Future<folly::Unit> write(Context* ctx, Win msg) = 0;
   virtual folly::Future<folly::Unit> writeException(
@@ -133,6 +145,16 @@ class InboundHandler : public HandlerBase<InboundHandlerContext<Rout>> {
   virtual void transportInactive(Context* ctx) {
     ctx->fireTransportInactive();
   }
+  virtual void writabilityChanged(Context* ctx, bool writable) {
+    ctx->fireWritabilityChanged(writable);
+  }
+  // Receives the messages of a fireReadBatch(). By default they are read()
+  // one at a time.
+  virtual void readBatch(Context* ctx, ReadBatch<Rin>& msgs) {
+    for (auto& msg : msgs) {
+      read(ctx, std::forward<Rin>(msg));
+    }
+  }
 };
 
 template <class Win, class Wout = Win>
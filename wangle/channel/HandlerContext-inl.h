@@ -17,6 +17,7 @@
 #pragma once
 
 #include <folly/Format.h>
+#include <wangle/channel/PipelineInstrumentation.h>
 #include <wangle/util/Logging.h>
 #include <typeinfo>
 
@@ -64,6 +65,8 @@ class InboundLink {
   virtual void readException(folly::exception_wrapper e) = 0;
   virtual void transportActive() = 0;
   virtual void transportInactive() = 0;
+  virtual void writabilityChanged(bool writable) = 0;
+  virtual void readBatch(ReadBatch<In>& msgs) = 0;
 };
 
 template <class Out>
@@ -231,6 +234,22 @@ class ContextImpl : public HandlerContext<typename H::rout, typename H::wout>,
     }
   }
 
+  void fireWritabilityChanged(bool writable) override {
+    auto guard = this->pipelineWeak_.lock();
+    if (this->nextIn_) {
+      this->nextIn_->writabilityChanged(writable);
+    }
+  }
+
+  void fireReadBatch(ReadBatch<Rout>& msgs) override {
+    auto guard = this->pipelineWeak_.lock();
+    if (this->nextIn_) {
+      this->nextIn_->readBatch(msgs);
+    } else {
+      WANGLE_LOG(WARNING) << "readBatch reached end of pipeline";
+    }
+  }
+
   folly::Future<folly::Unit> fireWrite(Wout msg) override {
     auto guard = this->pipelineWeak_.lock();
     if (this->nextOut_) {
@@ -290,6 +309,7 @@ class ContextImpl : public HandlerContext<typename H::rout, typename H::wout>,
   // InboundLink overrides
   void read(Rin msg) override {
     auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::READ);
     this->handler_->read(this, std::forward<Rin>(msg));
   }
 
@@ -313,9 +333,21 @@ class ContextImpl : public HandlerContext<typename H::rout, typename H::wout>,
     this->handler_->transportInactive(this);
   }
 
+  void writabilityChanged(bool writable) override {
+    auto guard = this->pipelineWeak_.lock();
+    this->handler_->writabilityChanged(this, writable);
+  }
+
+  void readBatch(ReadBatch<Rin>& msgs) override {
+    auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::READ);
+    this->handler_->readBatch(this, msgs);
+  }
+
   // OutboundLink overrides
   folly::Future<folly::Unit> write(Win msg) override {
     auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::WRITE);
     return this->handler_->write(this, std::forward<Win>(msg));
   }
 
@@ -405,6 +437,22 @@ class InboundContextImpl
     }
   }
 
+  void fireWritabilityChanged(bool writable) override {
+    auto guard = this->pipelineWeak_.lock();
+    if (this->nextIn_) {
+      this->nextIn_->writabilityChanged(writable);
+    }
+  }
+
+  void fireReadBatch(ReadBatch<Rout>& msgs) override {
+    auto guard = this->pipelineWeak_.lock();
+    if (this->nextIn_) {
+      this->nextIn_->readBatch(msgs);
+    } else {
+      WANGLE_LOG(WARNING) << "readBatch reached end of pipeline";
+    }
+  }
+
   PipelineBase* getPipeline() override {
     return this->pipelineRaw_;
   }
@@ -416,6 +464,7 @@ class InboundContextImpl
   // InboundLink overrides
   void read(Rin msg) override {
     auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::READ);
     this->handler_->read(this, std::forward<Rin>(msg));
   }
 
@@ -438,6 +487,17 @@ class InboundContextImpl
     auto guard = this->pipelineWeak_.lock();
     this->handler_->transportInactive(this);
   }
+
+  void writabilityChanged(bool writable) override {
+    auto guard = this->pipelineWeak_.lock();
+    this->handler_->writabilityChanged(this, writable);
+  }
+
+  void readBatch(ReadBatch<Rin>& msgs) override {
+    auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::READ);
+    this->handler_->readBatch(this, msgs);
+  }
 };
 
 template <class H>
@@ -509,6 +569,7 @@ class OutboundContextImpl
   // OutboundLink overrides
   folly::Future<folly::Unit> write(Win msg) override {
     auto guard = this->pipelineWeak_.lock();
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::WRITE);
     return this->handler_->write(this, std::forward<Win>(msg));
   }
 
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <type_traits>
+#include <vector>
+
 #include <fmt/format.h>
 
 #include <folly/ExceptionWrapper.h>
@@ -26,6 +29,11 @@ namespace wangle {
 
 class PipelineBase;
 
+// Messages passed on together with fireReadBatch(). A batch of references
+// holds the values referred to.
+template <class T>
+using ReadBatch = std::vector<std::decay_t<T>>;
+
 template <class In, class Out>
 class HandlerContext {
  public:
@@ -36,6 +44,10 @@ class HandlerContext {
   virtual void fireReadException(folly::exception_wrapper e) = 0;
   virtual void fireTransportActive() = 0;
   virtual void fireTransportInactive() = 0;
+  virtual void fireWritabilityChanged(bool writable) = 0;
+  // Passes on several messages at once, leaving them moved from. Handlers
+  // that do not implement readBatch() get them read() one at a time.
+  virtual void fireReadBatch(ReadBatch<In>& msgs) = 0;
 
   virtual folly::Future<folly::Unit> fireWrite(Out msg) = 0;
   virtual folly::Future<folly::Unit> fireWriteException(
@@ -47,6 +59,9 @@ class HandlerContext {
   std::shared_ptr<folly::AsyncTransport> getTransport() {
     return getPipeline()->getTransport();
   }
+  void setReadEnabled(bool enabled) {
+    getPipeline()->setReadEnabled(enabled);
+  }
 
   virtual void setWriteFlags(folly::WriteFlags flags) = 0;
   virtual folly::WriteFlags getWriteFlags() = 0;
@@ -77,12 +92,17 @@ class InboundHandlerContext {
   virtual void fireReadException(folly::exception_wrapper e) = 0;
   virtual void fireTransportActive() = 0;
   virtual void fireTransportInactive() = 0;
+  virtual void fireWritabilityChanged(bool writable) = 0;
+  virtual void fireReadBatch(ReadBatch<In>& msgs) = 0;
 
   virtual PipelineBase* getPipeline() = 0;
   virtual std::shared_ptr<PipelineBase> getPipelineShared() = 0;
   std::shared_ptr<folly::AsyncTransport> getTransport() {
     return getPipeline()->getTransport();
   }
+  void setReadEnabled(bool enabled) {
+    getPipeline()->setReadEnabled(enabled);
+  }
 
   // TODO Need get/set writeFlags, readBufferSettings? Probably not.
   // Do we even really need them stored in the pipeline at all?
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <wangle/channel/Pipeline.h>
+#include <wangle/channel/PipelineRecycler.h>
+#include <wangle/util/Logging.h>
+
+namespace wangle {
+
+namespace detail {
+
+constexpr size_t kNoLinkedContext = std::numeric_limits<size_t>::max();
+
+// Index of the first handler at or after I that handles inbound events.
+template <class HandlerTuple, size_t I>
+constexpr size_t nextInboundIndex() {
+  if constexpr (I >= std::tuple_size<HandlerTuple>::value) {
+    return kNoLinkedContext;
+  } else if constexpr (
+      std::tuple_element_t<I, HandlerTuple>::dir != HandlerDir::OUT) {
+    return I;
+  } else {
+    return nextInboundIndex<HandlerTuple, I + 1>();
+  }
+}
+
+// Index of the last handler before I that handles outbound events.
+template <class HandlerTuple, size_t I>
+constexpr size_t prevOutboundIndex() {
+  if constexpr (I == 0) {
+    return kNoLinkedContext;
+  } else if constexpr (
+      std::tuple_element_t<I - 1, HandlerTuple>::dir != HandlerDir::IN) {
+    return I - 1;
+  } else {
+    return prevOutboundIndex<HandlerTuple, I - 1>();
+  }
+}
+
+template <class P, class HandlerTuple, size_t I>
+class LinkedContextImpl;
+
+// The regular context of handler I, plus the statically known pipeline and
+// handler.
+template <class P, class HandlerTuple, size_t I>
+class LinkedContextCore : public ContextType<
+                              std::tuple_element_t<I, HandlerTuple>>::type {
+ public:
+  using H = std::tuple_element_t<I, HandlerTuple>;
+
+  void link(P* pipeline, H* handler) {
+    pipeline_ = pipeline;
+    linkedHandler_ = handler;
+  }
+
+ protected:
+  LinkedContextImpl<P, HandlerTuple, I>* self() {
+    return static_cast<LinkedContextImpl<P, HandlerTuple, I>*>(this);
+  }
+
+  P* pipeline_{nullptr};
+  H* linkedHandler_{nullptr};
+};
+
+// Inbound events go straight to the next inbound context's handler. The
+// handler is called non-virtually, since the pipeline owns it by value and
+// knows its exact type, which lets the compiler inline the chain.
+template <class P, class HandlerTuple, size_t I, class Base, bool Inbound>
+class LinkedInboundContext : public Base {};
+
+template <class P, class HandlerTuple, size_t I, class Base>
+class LinkedInboundContext<P, HandlerTuple, I, Base, true> : public Base {
+ public:
+  using H = std::tuple_element_t<I, HandlerTuple>;
+  using Rin = typename H::rin;
+  using Rout = typename H::rout;
+  static constexpr size_t kNextIn = nextInboundIndex<HandlerTuple, I + 1>();
+
+  void fireRead(Rout msg) override {
+    if constexpr (kNextIn == kNoLinkedContext) {
+      Base::fireRead(std::forward<Rout>(msg));
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>().linkedRead(
+          std::forward<Rout>(msg));
+    }
+  }
+
+  void fireReadEOF() override {
+    if constexpr (kNextIn == kNoLinkedContext) {
+      Base::fireReadEOF();
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>().linkedReadEOF();
+    }
+  }
+
+  void fireReadException(folly::exception_wrapper e) override {
+    if constexpr (kNextIn == kNoLinkedContext) {
+      Base::fireReadException(std::move(e));
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>()
+          .linkedReadException(std::move(e));
+    }
+  }
+
+  void fireTransportActive() override {
+    if constexpr (kNextIn != kNoLinkedContext) {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>()
+          .linkedTransportActive();
+    }
+  }
+
+  void fireTransportInactive() override {
+    if constexpr (kNextIn != kNoLinkedContext) {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>()
+          .linkedTransportInactive();
+    }
+  }
+
+  void fireWritabilityChanged(bool writable) override {
+    if constexpr (kNextIn != kNoLinkedContext) {
+      auto guard = this->pipelineWeak_.lock();
+      this->pipeline_->template getLinkedContext<kNextIn>()
+          .linkedWritabilityChanged(writable);
+    }
+  }
+
+  // Called by the previous inbound context, which holds the pipeline guard.
+  void linkedRead(Rin msg) {
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::READ);
+    this->linkedHandler_->H::read(this->self(), std::forward<Rin>(msg));
+  }
+
+  void linkedReadEOF() {
+    this->linkedHandler_->H::readEOF(this->self());
+  }
+
+  void linkedReadException(folly::exception_wrapper e) {
+    this->linkedHandler_->H::readException(this->self(), std::move(e));
+  }
+
+  void linkedTransportActive() {
+    this->linkedHandler_->H::transportActive(this->self());
+  }
+
+  void linkedTransportInactive() {
+    this->linkedHandler_->H::transportInactive(this->self());
+  }
+
+  void linkedWritabilityChanged(bool writable) {
+    this->linkedHandler_->H::writabilityChanged(this->self(), writable);
+  }
+};
+
+// Outbound counterpart of LinkedInboundContext.
+template <class P, class HandlerTuple, size_t I, class Base, bool Outbound>
+class LinkedOutboundContext : public Base {};
+
+template <class P, class HandlerTuple, size_t I, class Base>
+class LinkedOutboundContext<P, HandlerTuple, I, Base, true> : public Base {
+ public:
+  using H = std::tuple_element_t<I, HandlerTuple>;
+  using Win = typename H::win;
+  using Wout = typename H::wout;
+  static constexpr size_t kNextOut = prevOutboundIndex<HandlerTuple, I>();
+
+  folly::Future<folly::Unit> fireWrite(Wout msg) override {
+    if constexpr (kNextOut == kNoLinkedContext) {
+      return Base::fireWrite(std::forward<Wout>(msg));
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      return this->pipeline_->template getLinkedContext<kNextOut>()
+          .linkedWrite(std::forward<Wout>(msg));
+    }
+  }
+
+  folly::Future<folly::Unit> fireWriteException(
+      folly::exception_wrapper e) override {
+    if constexpr (kNextOut == kNoLinkedContext) {
+      return Base::fireWriteException(std::move(e));
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      return this->pipeline_->template getLinkedContext<kNextOut>()
+          .linkedWriteException(std::move(e));
+    }
+  }
+
+  folly::Future<folly::Unit> fireClose() override {
+    if constexpr (kNextOut == kNoLinkedContext) {
+      return Base::fireClose();
+    } else {
+      auto guard = this->pipelineWeak_.lock();
+      return this->pipeline_->template getLinkedContext<kNextOut>()
+          .linkedClose();
+    }
+  }
+
+  // Called by the previous outbound context, which holds the pipeline guard.
+  folly::Future<folly::Unit> linkedWrite(Win msg) {
+    detail::HandlerSample<H> sample(PipelineInstrumentation::Event::WRITE);
+    return this->linkedHandler_->H::write(
+        this->self(), std::forward<Win>(msg));
+  }
+
+  folly::Future<folly::Unit> linkedWriteException(folly::exception_wrapper e) {
+    return this->linkedHandler_->H::writeException(this->self(), std::move(e));
+  }
+
+  folly::Future<folly::Unit> linkedClose() {
+    return this->linkedHandler_->H::close(this->self());
+  }
+};
+
+template <class P, class HandlerTuple, size_t I>
+class LinkedContextImpl final
+    : public LinkedOutboundContext<
+          P,
+          HandlerTuple,
+          I,
+          LinkedInboundContext<
+              P,
+              HandlerTuple,
+              I,
+              LinkedContextCore<P, HandlerTuple, I>,
+              std::tuple_element_t<I, HandlerTuple>::dir != HandlerDir::OUT>,
+          std::tuple_element_t<I, HandlerTuple>::dir != HandlerDir::IN> {
+ public:
+  using ContextBase =
+      typename ContextType<std::tuple_element_t<I, HandlerTuple>>::type;
+  static constexpr size_t kNextIn = nextInboundIndex<HandlerTuple, I + 1>();
+  static constexpr size_t kNextOut = prevOutboundIndex<HandlerTuple, I>();
+
+  // The links are fixed at compile time; these only verify that finalize()
+  // agrees with them, i.e. that no handler was added or removed.
+  void setNextIn(PipelineContext* ctx) override {
+    ContextBase::setNextIn(ctx);
+    if constexpr (kNextIn == kNoLinkedContext) {
+      WANGLE_CHECK(!ctx) << "LinkedStaticPipeline handlers are fixed";
+    } else {
+      WANGLE_CHECK(
+          ctx == &this->pipeline_->template getLinkedContext<kNextIn>())
+          << "LinkedStaticPipeline handlers are fixed";
+    }
+  }
+
+  void setNextOut(PipelineContext* ctx) override {
+    ContextBase::setNextOut(ctx);
+    if constexpr (kNextOut == kNoLinkedContext) {
+      WANGLE_CHECK(!ctx) << "LinkedStaticPipeline handlers are fixed";
+    } else {
+      WANGLE_CHECK(
+          ctx == &this->pipeline_->template getLinkedContext<kNextOut>())
+          << "LinkedStaticPipeline handlers are fixed";
+    }
+  }
+};
+
+template <class P, class HandlerTuple, class Indices>
+struct LinkedContexts;
+
+template <class P, class HandlerTuple, size_t... Is>
+struct LinkedContexts<P, HandlerTuple, std::index_sequence<Is...>> {
+  using type = std::tuple<LinkedContextImpl<P, HandlerTuple, Is>...>;
+};
+
+} // namespace detail
+
+/*
+ * LinkedStaticPipeline is a StaticPipeline whose contexts are linked at
+ * compile time. Each context knows the concrete type of its neighbors and of
+ * their handlers, so fireRead(), fireWrite() and friends call the next
+ * handler directly instead of going through the virtual InboundLink and
+ * OutboundLink interfaces, and a fixed stack such as
+ *
+ * LinkedStaticPipeline<folly::IOBufQueue&, std::string,
+ *   AsyncSocketHandler,
+ *   LengthFieldBasedFrameDecoder,
+ *   StringCodec,
+ *   MyDispatcher>::create(
+ *     AsyncSocketHandler(socket),
+ *     LengthFieldBasedFrameDecoder(),
+ *     StringCodec(),
+ *     MyDispatcher())
+ *
+ * can be inlined end to end. Handlers are moved into the pipeline, so each
+ * must be a concrete, movable type, and none can be added or removed once
+ * the pipeline is created. Otherwise it is used like any Pipeline.
+ */
+template <class R, class W, class... Handlers>
+class LinkedStaticPipeline : public Pipeline<R, W> {
+ public:
+  using Ptr = std::shared_ptr<LinkedStaticPipeline>;
+  using HandlerTuple = std::tuple<Handlers...>;
+
+  template <size_t I>
+  using LinkedContext =
+      detail::LinkedContextImpl<LinkedStaticPipeline, HandlerTuple, I>;
+
+  static_assert(sizeof...(Handlers) > 0, "LinkedStaticPipeline needs handlers");
+  static_assert(
+      !std::disjunction_v<std::is_abstract<Handlers>...>,
+      "LinkedStaticPipeline handlers must be concrete types");
+
+  static Ptr create(Handlers... handlers) {
+    auto ptr = Ptr(new LinkedStaticPipeline(std::move(handlers)...));
+    ptr->initialize(std::index_sequence_for<Handlers...>());
+    return ptr;
+  }
+
+  // See StaticPipeline::createRecycled().
+  static Ptr createRecycled(folly::EventBase& evb, Handlers... handlers) {
+    auto ptr = std::allocate_shared<LinkedStaticPipeline>(
+        PipelineRecyclingAllocator<LinkedStaticPipeline>(
+            PipelineRecycler::get<LinkedStaticPipeline>(evb)),
+        CreateKey(),
+        std::move(handlers)...);
+    ptr->initialize(std::index_sequence_for<Handlers...>());
+    return ptr;
+  }
+
+  class CreateKey {
+    CreateKey() {}
+    friend LinkedStaticPipeline;
+  };
+
+  // For std::allocate_shared() in createRecycled().
+  LinkedStaticPipeline(CreateKey, Handlers&&... handlers)
+      : LinkedStaticPipeline(std::move(handlers)...) {}
+
+  ~LinkedStaticPipeline() override {
+    Pipeline<R, W>::detachHandlers();
+  }
+
+  template <size_t I>
+  LinkedContext<I>& getLinkedContext() {
+    return std::get<I>(contexts_);
+  }
+
+ private:
+  explicit LinkedStaticPipeline(Handlers&&... handlers)
+      : Pipeline<R, W>(true), handlers_(std::move(handlers)...) {}
+
+  template <size_t... Is>
+  void initialize(std::index_sequence<Is...>) {
+    Pipeline<R, W>::reserveContexts(sizeof...(Is));
+    (initializeContext<Is>(), ...);
+    Pipeline<R, W>::finalize();
+  }
+
+  template <size_t I>
+  void initializeContext() {
+    auto& ctx = std::get<I>(contexts_);
+    auto& handler = std::get<I>(handlers_);
+    ctx.link(this, &handler);
+    Pipeline<R, W>::addContextBack(&ctx);
+    ctx.initialize(
+        Pipeline<R, W>::shared_from_this(), detail::nonOwningPtr(&handler));
+  }
+
+  HandlerTuple handlers_;
+  typename detail::LinkedContexts<
+      LinkedStaticPipeline,
+      HandlerTuple,
+      std::index_sequence_for<Handlers...>>::type contexts_;
+};
+
+} // namespace wangle
@@ -22,70 +22,120 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <wangle/channel/Handler.h>
+#include <wangle/channel/WriteFlushScheduler.h>
 #include <wangle/util/Logging.h>
 
 namespace wangle {
 
 /*
  * OutputBufferingHandler buffers writes in order to minimize syscalls. The
- * transport will be written to once per event loop instead of on every write.
+ * transport will be written to once per event loop instead of on every write,
+ * or earlier once the buffered writes reach a flush threshold. With
+ * setUseFlushScheduler(true), the end-of-loop flush goes through the
+ * EventBase's WriteFlushScheduler, which flushes all such pipelines from one
+ * loop callback.
  *
  * This handler may only be used in a single Pipeline.
  */
 class OutputBufferingHandler : public OutboundBytesToBytesHandler,
-                               protected folly::EventBase::LoopCallback {
+                               protected folly::EventBase::LoopCallback,
+                               protected WriteFlushScheduler::Flushable {
  public:
+  void setUseFlushScheduler(bool useFlushScheduler) {
+    useFlushScheduler_ = useFlushScheduler;
+  }
+
+  /*
+   * Flush as soon as the buffered writes reach maxBytes bytes or maxIovecs
+   * IOBufs, rather than waiting for the end of the loop iteration. 0 disables
+   * a threshold.
+   */
+  void setFlushThresholds(size_t maxBytes, size_t maxIovecs) {
+    maxBufferedBytes_ = maxBytes;
+    maxBufferedIovecs_ = maxIovecs;
+  }
+
+  /*
+   * Send batches flushed early by a threshold with WriteFlags::CORK. The
+   * write that crosses the threshold stays buffered, so the last batch of the
+   * loop iteration always goes out uncorked. CORK is passed with
+   * PipelineBase::setNextWriteFlags(), which AsyncSocketHandler applies.
+   */
+  void setCorkEarlyFlushes(bool cork) {
+    corkEarlyFlushes_ = cork;
+  }
+
+  /*
+   * Return an empty future from write() instead of one per buffered write,
+   * which saves a promise allocation per write. Write errors are then only
+   * seen by the transport handler, e.g. AsyncSocketHandler in fire and forget
+   * mode reports them through readException().
+   */
+  void setFireAndForgetWrites(bool fireAndForget) {
+    fireAndForgetWrites_ = fireAndForget;
+  }
+
   folly::Future<folly::Unit> write(
       Context* ctx,
       std::unique_ptr<folly::IOBuf> buf) override {
     WANGLE_CHECK(buf);
     if (!queueSends_) {
       return ctx->fireWrite(std::move(buf));
+    }
+
+    const auto bytes = buf->computeChainDataLength();
+    const auto iovecs = buf->countChainElements();
+    if (sends_ && corkEarlyFlushes_ && reachesFlushThreshold(bytes, iovecs)) {
+      flush(ctx, folly::WriteFlags::CORK);
+    }
+
+    // Delay sends to optimize for fewer syscalls
+    if (!sends_) {
+      sends_ = std::move(buf);
     } else {
-      // Delay sends to optimize for fewer syscalls
-      if (!sends_) {
-        WANGLE_DCHECK(!isLoopCallbackScheduled());
-        // Buffer all the sends, and call writev once per event loop.
-        sends_ = std::move(buf);
-        ctx->getTransport()->getEventBase()->runInLoop(this);
-      } else {
-        WANGLE_DCHECK(isLoopCallbackScheduled());
-        sends_->prependChain(std::move(buf));
-      }
-      return sharedPromise_.getFuture();
+      sends_->prependChain(std::move(buf));
     }
+    bufferedBytes_ += bytes;
+    bufferedIovecs_ += iovecs;
+    auto future = fireAndForgetWrites_ ? folly::Future<folly::Unit>::makeEmpty()
+                                       : sharedPromise_.getFuture();
+
+    if (!corkEarlyFlushes_ && reachesFlushThreshold(0, 0)) {
+      cancelScheduledFlush();
+      flush(ctx, folly::WriteFlags::NONE);
+    } else {
+      scheduleFlush(ctx);
+    }
+    return future;
   }
 
   void runLoopCallback() noexcept override {
-    folly::SharedPromise<folly::Unit> sharedPromise;
-    std::swap(sharedPromise, sharedPromise_);
-    getContext()
-        ->fireWrite(std::move(sends_))
-        .thenTry([sharedPromise_2 = std::move(sharedPromise)](
-                     folly::Try<folly::Unit> t) mutable {
-          sharedPromise_2.setTry(std::move(t));
-        });
+    flush(getContext(), folly::WriteFlags::NONE);
+  }
+
+  void flushWrites() noexcept override {
+    flush(getContext(), folly::WriteFlags::NONE);
   }
 
   void cleanUp() {
-    if (isLoopCallbackScheduled()) {
-      cancelLoopCallback();
-    }
+    cancelScheduledFlush();
 
     sends_.reset();
+    bufferedBytes_ = 0;
+    bufferedIovecs_ = 0;
     sharedPromise_ = folly::SharedPromise<folly::Unit>();
   }
 
   folly::Future<folly::Unit> close(Context* ctx) override {
-    if (isLoopCallbackScheduled()) {
-      cancelLoopCallback();
-    }
+    cancelScheduledFlush();
 
     // If there are sends queued, cancel them
     sharedPromise_.setException(
         folly::make_exception_wrapper<std::runtime_error>(
             "close() called while sends still pending"));
     sends_.reset();
+    bufferedBytes_ = 0;
+    bufferedIovecs_ = 0;
     sharedPromise_ = folly::SharedPromise<folly::Unit>();
     return ctx->fireClose();
   }
@@ -93,6 +143,64 @@ class OutputBufferingHandler : public OutboundBytesToBytesHandler,
   folly::SharedPromise<folly::Unit> sharedPromise_;
   std::unique_ptr<folly::IOBuf> sends_{nullptr};
   bool queueSends_{true};
+
+ private:
+  void scheduleFlush(Context* ctx) {
+    auto evb = ctx->getTransport()->getEventBase();
+    if (useFlushScheduler_) {
+      WriteFlushScheduler::get(*evb).schedule(*this);
+    } else if (!isLoopCallbackScheduled()) {
+      // Buffer all the sends, and call writev once per event loop.
+      evb->runInLoop(this);
+    }
+  }
+
+  void cancelScheduledFlush() {
+    if (isLoopCallbackScheduled()) {
+      cancelLoopCallback();
+    }
+    cancelFlush();
+  }
+
+  bool reachesFlushThreshold(size_t bytes, size_t iovecs) const {
+    return (maxBufferedBytes_ && bufferedBytes_ + bytes >= maxBufferedBytes_) ||
+        (maxBufferedIovecs_ && bufferedIovecs_ + iovecs >= maxBufferedIovecs_);
+  }
+
+  void flush(Context* ctx, folly::WriteFlags flags) {
+    bufferedBytes_ = 0;
+    bufferedIovecs_ = 0;
+    // Only for this write: if no transport handler takes them, they must
+    // not stick to a later one.
+    auto pipeline = ctx->getPipeline();
+    pipeline->setNextWriteFlags(flags);
+    auto future = ctx->fireWrite(std::move(sends_));
+    pipeline->takeNextWriteFlags();
+
+    if (fireAndForgetWrites_) {
+      return;
+    }
+    folly::SharedPromise<folly::Unit> sharedPromise;
+    std::swap(sharedPromise, sharedPromise_);
+    if (!future.valid()) {
+      // The transport handler does not report per-write results either.
+      sharedPromise.setValue();
+      return;
+    }
+    std::move(future).thenTry(
+        [sharedPromise_2 = std::move(sharedPromise)](
+            folly::Try<folly::Unit> t) mutable {
+          sharedPromise_2.setTry(std::move(t));
+        });
+  }
+
+  size_t maxBufferedBytes_{0};
+  size_t maxBufferedIovecs_{0};
+  size_t bufferedBytes_{0};
+  size_t bufferedIovecs_{0};
+  bool corkEarlyFlushes_{false};
+  bool fireAndForgetWrites_{false};
+  bool useFlushScheduler_{false};
 };
 
 } // namespace wangle
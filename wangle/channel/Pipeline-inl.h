@@ -20,6 +20,17 @@
 
 namespace wangle {
 
+namespace detail {
+
+// A shared_ptr that does not own ptr. Aliasing an empty shared_ptr, unlike a
+// no-op deleter, needs no control block allocation.
+template <class T>
+std::shared_ptr<T> nonOwningPtr(T* ptr) {
+  return std::shared_ptr<T>(std::shared_ptr<void>(), ptr);
+}
+
+} // namespace detail
+
 template <class R, class W>
 Pipeline<R, W>::Pipeline() : isStatic_(false) {}
 
@@ -49,7 +60,7 @@ PipelineBase& PipelineBase::addBack(H&& handler) {
 
 template <class H>
 PipelineBase& PipelineBase::addBack(H* handler) {
-  return addBack(std::shared_ptr<H>(handler, [](H*) {}));
+  return addBack(detail::nonOwningPtr(handler));
 }
 
 template <class H>
@@ -66,7 +77,7 @@ PipelineBase& PipelineBase::addFront(H&& handler) {
 
 template <class H>
 PipelineBase& PipelineBase::addFront(H* handler) {
-  return addFront(std::shared_ptr<H>(handler, [](H*) {}));
+  return addFront(detail::nonOwningPtr(handler));
 }
 
 template <class H>
@@ -146,7 +157,12 @@ bool PipelineBase::setOwner(H* handler) {
 
 template <class Context>
 void PipelineBase::addContextFront(Context* ctx) {
-  addHelper(std::shared_ptr<Context>(ctx, [](Context*) {}), true);
+  addHelper(detail::nonOwningPtr(ctx), true);
+}
+
+template <class Context>
+void PipelineBase::addContextBack(Context* ctx) {
+  addHelper(detail::nonOwningPtr(ctx), false);
 }
 
 template <class Context>
@@ -182,8 +198,7 @@ template <class R, class W>
 template <class T>
 typename std::enable_if<!std::is_same<T, folly::Unit>::value>::type
 Pipeline<R, W>::read(R msg) {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
 
   if (!front_) {
     throw std::invalid_argument("read(): no inbound handler in Pipeline");
@@ -195,8 +210,7 @@ template <class R, class W>
 template <class T>
 typename std::enable_if<!std::is_same<T, folly::Unit>::value>::type
 Pipeline<R, W>::readEOF() {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (!front_) {
     throw std::invalid_argument("readEOF(): no inbound handler in Pipeline");
   }
@@ -207,8 +221,7 @@ template <class R, class W>
 template <class T>
 typename std::enable_if<!std::is_same<T, folly::Unit>::value>::type
 Pipeline<R, W>::transportActive() {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (front_) {
     front_->transportActive();
   }
@@ -218,8 +231,7 @@ template <class R, class W>
 template <class T>
 typename std::enable_if<!std::is_same<T, folly::Unit>::value>::type
 Pipeline<R, W>::transportInactive() {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (front_) {
     front_->transportInactive();
   }
@@ -229,8 +241,7 @@ template <class R, class W>
 template <class T>
 typename std::enable_if<!std::is_same<T, folly::Unit>::value>::type
 Pipeline<R, W>::readException(folly::exception_wrapper e) {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (!front_) {
     throw std::invalid_argument(
         "readException(): no inbound handler in Pipeline");
@@ -244,8 +255,7 @@ typename std::enable_if<
     !std::is_same<T, folly::Unit>::value,
     folly::Future<folly::Unit>>::type
 Pipeline<R, W>::write(W msg) {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (!back_) {
     throw std::invalid_argument("write(): no outbound handler in Pipeline");
   }
@@ -258,8 +268,7 @@ typename std::enable_if<
     !std::is_same<T, folly::Unit>::value,
     folly::Future<folly::Unit>>::type
 Pipeline<R, W>::writeException(folly::exception_wrapper e) {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (!back_) {
     throw std::invalid_argument(
         "writeException(): no outbound handler in Pipeline");
@@ -273,8 +282,7 @@ typename std::enable_if<
     !std::is_same<T, folly::Unit>::value,
     folly::Future<folly::Unit>>::type
 Pipeline<R, W>::close() {
-  OptionalReqCtxScopeGuard optGuard;
-  fillRequestContextGuard(optGuard);
+  RequestContextGuard ctxGuard(*this);
   if (!back_) {
     throw std::invalid_argument("close(): no outbound handler in Pipeline");
   }
@@ -319,11 +327,35 @@ void Pipeline<R, W>::finalize() {
 }
 
 template <class R, class W>
-void Pipeline<R, W>::fillRequestContextGuard(
-    OptionalReqCtxScopeGuard& optGuard) {
-  WANGLE_CHECK(!optGuard.has_value());
-  if (requestContext_) {
-    optGuard.emplace(requestContext_);
+Pipeline<R, W>::RequestContextGuard::RequestContextGuard(Pipeline& pipeline) {
+  const auto& requestContext = pipeline.requestContext_;
+  if (!requestContext) {
+    return;
+  }
+  auto& stats = pipeline.requestContextStats_;
+  if (pipeline.requestContextPolicy_ == RequestContextPolicy::ENTRY_POINT) {
+    auto& entered = detail::enteredPipeline();
+    if (entered == &pipeline) {
+      // Called back into from one of our own handlers.
+      stats.skipped++;
+      return;
+    }
+    prevEntered_ = entered;
+    entered = &pipeline;
+    entered_ = true;
+    if (folly::RequestContext::try_get() == requestContext.get()) {
+      stats.skipped++;
+      return;
+    }
+  }
+  scopeGuard_.emplace(requestContext);
+  stats.switches++;
+}
+
+template <class R, class W>
+Pipeline<R, W>::RequestContextGuard::~RequestContextGuard() {
+  if (entered_) {
+    detail::enteredPipeline() = prevEntered_;
   }
 }
 
@@ -39,6 +39,30 @@ std::pair<uint64_t, uint64_t> PipelineBase::getReadBufferSettings() {
   return readBufferSettings_;
 }
 
+void PipelineBase::setWriteBufferWatermarks(
+    uint64_t lowWatermark,
+    uint64_t highWatermark) {
+  WANGLE_CHECK_LE(lowWatermark, highWatermark);
+  writeBufferWatermarks_ = std::make_pair(lowWatermark, highWatermark);
+}
+
+std::pair<uint64_t, uint64_t> PipelineBase::getWriteBufferWatermarks() {
+  return writeBufferWatermarks_;
+}
+
+void PipelineBase::setReadEnabled(bool enabled) {
+  if (readEnabled_.exchange(enabled) == enabled) {
+    return;
+  }
+  if (auto controller = getReadFlowController()) {
+    controller->readEnabledChanged();
+  }
+}
+
+bool PipelineBase::isReadEnabled() const {
+  return readEnabled_.load();
+}
+
 void PipelineBase::setTransportInfo(std::shared_ptr<TransportInfo> tInfo) {
   transportInfo_ = tInfo;
 }
@@ -91,6 +115,12 @@ void PipelineBase::detachHandlers() {
   }
 }
 
+void PipelineBase::reserveContexts(size_t numHandlers) {
+  ctxs_.reserve(numHandlers);
+  inCtxs_.reserve(numHandlers);
+  outCtxs_.reserve(numHandlers);
+}
+
 size_t PipelineBase::numHandlers() const {
   return ctxs_.size();
 }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <utility>
 #include <variant>
 
 #include <folly/ExceptionWrapper.h>
@@ -45,6 +47,37 @@ class PipelineManager {
   virtual void adjustTimeout(std::chrono::milliseconds /*newTimeout*/) {}
 };
 
+// Implemented by the handler that owns the transport's read callback, so that
+// PipelineBase::setReadEnabled() can stop and resume reads.
+class ReadFlowController {
+ public:
+  virtual ~ReadFlowController() = default;
+  // Called from any thread after the pipeline's read state changed.
+  virtual void readEnabledChanged() = 0;
+};
+
+// When a Pipeline installs the RequestContext given to setRequestContext().
+enum class RequestContextPolicy : uint8_t {
+  // Around every read()/write()/etc. call on the pipeline, including calls
+  // made from within its own handlers.
+  PER_CALL,
+  // Only when the pipeline is entered from outside its handlers, and only if
+  // the context is not current already. Calls a handler makes back into the
+  // pipeline run with whatever context is current at that point.
+  ENTRY_POINT,
+};
+
+namespace detail {
+
+// The pipeline the current thread most recently entered under
+// RequestContextPolicy::ENTRY_POINT.
+inline const PipelineBase*& enteredPipeline() {
+  static thread_local const PipelineBase* pipeline{nullptr};
+  return pipeline;
+}
+
+} // namespace detail
+
 class PipelineBase : public std::enable_shared_from_this<PipelineBase> {
  public:
   virtual ~PipelineBase() = default;
@@ -74,9 +107,80 @@ class PipelineBase : public std::enable_shared_from_this<PipelineBase> {
   void setWriteFlags(folly::WriteFlags flags);
   folly::WriteFlags getWriteFlags();
 
+  /**
+   * Flags added to the write flags for the next write the transport handler
+   * issues only, e.g. WriteFlags::CORK for one batch. The transport handler
+   * clears them with takeNextWriteFlags(), so writes made while that write
+   * is in progress, from a callback or another handler, don't get them.
+   */
+  void setNextWriteFlags(folly::WriteFlags flags) {
+    nextWriteFlags_ = flags;
+  }
+
+  folly::WriteFlags takeNextWriteFlags() {
+    return std::exchange(nextWriteFlags_, folly::WriteFlags::NONE);
+  }
+
   void setReadBufferSettings(uint64_t minAvailable, uint64_t allocationSize);
   std::pair<uint64_t, uint64_t> getReadBufferSettings();
 
+  /**
+   * Bytes the pipeline still needs to receive before its decoder can make
+   * progress, or 0 if unknown. Set by ByteToMessageDecoder from decode()'s
+   * needed hint; transport handlers size their next read buffer with it.
+   */
+  void setReadBytesExpected(uint64_t bytes) {
+    readBytesExpected_ = bytes;
+  }
+
+  uint64_t getReadBytesExpected() const {
+    return readBytesExpected_;
+  }
+
+  // The handler that sets the read bytes expected. ByteToMessageDecoder
+  // claims it on the first read that reaches one, which is the decoder
+  // nearest the transport.
+  void setReadBytesExpectedOwner(const void* owner) {
+    readBytesExpectedOwner_ = owner;
+  }
+
+  const void* getReadBytesExpectedOwner() const {
+    return readBytesExpectedOwner_;
+  }
+
+  /**
+   * Once the transport buffers more than highWatermark outbound bytes,
+   * writabilityChanged(false) is fired inbound; writabilityChanged(true)
+   * follows when it drains to lowWatermark or below. A highWatermark of 0
+   * (the default) disables tracking.
+   *
+   * The transport's buffer is only checked when a write is issued and when
+   * one completes, as AsyncTransport doesn't report partial progress. So
+   * while a single large write drains, writabilityChanged(true) comes once
+   * it has been written completely rather than at lowWatermark.
+   */
+  void setWriteBufferWatermarks(uint64_t lowWatermark, uint64_t highWatermark);
+  std::pair<uint64_t, uint64_t> getWriteBufferWatermarks();
+
+  /**
+   * Stops (false) or resumes (true) reading from the transport without
+   * firing transportInactive. Safe to call from any thread; the read
+   * callback is detached or reattached on the transport's EventBase.
+   */
+  void setReadEnabled(bool enabled);
+  bool isReadEnabled() const;
+
+  // Set and cleared by the transport handler as it is attached and
+  // detached. Atomic as setReadEnabled() reads it from any thread; the
+  // controller has to outlive such calls, as the pipeline itself does.
+  void setReadFlowController(ReadFlowController* controller) {
+    readFlowController_.store(controller, std::memory_order_release);
+  }
+
+  ReadFlowController* getReadFlowController() const {
+    return readFlowController_.load(std::memory_order_acquire);
+  }
+
   void setTransportInfo(std::shared_ptr<TransportInfo> tInfo);
   std::shared_ptr<TransportInfo> getTransportInfo();
 
@@ -135,6 +239,12 @@ class PipelineBase : public std::enable_shared_from_this<PipelineBase> {
   template <class Context>
   void addContextFront(Context* ctx);
 
+  template <class Context>
+  void addContextBack(Context* ctx);
+
+  // Sizes the context lists up front for a pipeline of numHandlers handlers.
+  void reserveContexts(size_t numHandlers);
+
   void detachHandlers();
 
   std::vector<std::shared_ptr<PipelineContext>> ctxs_;
@@ -158,7 +268,13 @@ class PipelineBase : public std::enable_shared_from_this<PipelineBase> {
   ContextIterator removeAt(const ContextIterator& it);
 
   folly::WriteFlags writeFlags_{folly::WriteFlags::NONE};
+  folly::WriteFlags nextWriteFlags_{folly::WriteFlags::NONE};
   std::pair<uint64_t, uint64_t> readBufferSettings_{2048, 2048};
+  uint64_t readBytesExpected_{0};
+  const void* readBytesExpectedOwner_{nullptr};
+  std::pair<uint64_t, uint64_t> writeBufferWatermarks_{0, 0};
+  std::atomic<bool> readEnabled_{true};
+  std::atomic<ReadFlowController*> readFlowController_{nullptr};
 
   std::shared_ptr<PipelineContext> owner_;
 };
@@ -231,15 +347,43 @@ class Pipeline : public PipelineBase {
     requestContext_ = std::move(requestContext);
   }
 
+  void setRequestContextPolicy(RequestContextPolicy policy) {
+    requestContextPolicy_ = policy;
+  }
+
+  struct RequestContextStats {
+    // Calls that made the request context current.
+    uint64_t switches{0};
+    // Calls that found it current already, or re-entered the pipeline, under
+    // RequestContextPolicy::ENTRY_POINT.
+    uint64_t skipped{0};
+  };
+
+  const RequestContextStats& getRequestContextStats() const {
+    return requestContextStats_;
+  }
+
  protected:
   Pipeline();
   explicit Pipeline(bool isStatic);
 
  private:
-  using OptionalReqCtxScopeGuard =
-      folly::Optional<folly::RequestContextScopeGuard>;
-
-  void fillRequestContextGuard(OptionalReqCtxScopeGuard& optGuard);
+  // Installs requestContext_ for the duration of a call into the pipeline.
+  // Does not touch the pipeline on destruction, which may have been deleted
+  // by then.
+  class RequestContextGuard {
+   public:
+    explicit RequestContextGuard(Pipeline& pipeline);
+    ~RequestContextGuard();
+
+    RequestContextGuard(const RequestContextGuard&) = delete;
+    RequestContextGuard& operator=(const RequestContextGuard&) = delete;
+
+   private:
+    folly::Optional<folly::RequestContextScopeGuard> scopeGuard_;
+    bool entered_{false};
+    const PipelineBase* prevEntered_{nullptr};
+  };
 
   bool isStatic_{false};
 
@@ -247,6 +391,8 @@ class Pipeline : public PipelineBase {
   OutboundLink<W>* back_{nullptr};
 
   std::shared_ptr<folly::RequestContext> requestContext_;
+  RequestContextPolicy requestContextPolicy_{RequestContextPolicy::PER_CALL};
+  RequestContextStats requestContextStats_;
 };
 
 } // namespace wangle
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/channel/PipelineInstrumentation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <folly/Indestructible.h>
+#include <folly/ThreadLocal.h>
+#include <folly/lang/Bits.h>
+
+namespace wangle {
+
+namespace {
+
+constexpr size_t kNumEvents = 2;
+constexpr size_t kNumBuckets = PipelineInstrumentation::Histogram::kNumBuckets;
+
+// Only the owning thread writes, collect() and reset() read from others.
+struct AtomicHistogram {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> totalTicks{0};
+  std::atomic<uint64_t> maxTicks{0};
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+};
+
+using HandlerHistograms = std::array<AtomicHistogram, kNumEvents>;
+
+struct ThreadHistograms {
+  // Guards histograms, which only its thread changes, against other threads
+  // reading it.
+  std::mutex mutex;
+  std::vector<std::unique_ptr<HandlerHistograms>> histograms;
+};
+
+struct InstrumentationTag {};
+
+using ThreadHistogramsLocal =
+    folly::ThreadLocal<ThreadHistograms, InstrumentationTag>;
+
+ThreadHistogramsLocal& threadHistograms() {
+  static folly::Indestructible<ThreadHistogramsLocal> histograms;
+  return *histograms;
+}
+
+struct HandlerRegistry {
+  std::mutex mutex;
+  std::vector<std::string> names;
+};
+
+HandlerRegistry& handlerRegistry() {
+  static folly::Indestructible<HandlerRegistry> registry;
+  return *registry;
+}
+
+void add(std::atomic<uint64_t>& counter, uint64_t delta) {
+  counter.store(
+      counter.load(std::memory_order_relaxed) + delta,
+      std::memory_order_relaxed);
+}
+
+void mergeInto(
+    PipelineInstrumentation::Histogram& merged,
+    const AtomicHistogram& histogram) {
+  merged.count += histogram.count.load(std::memory_order_relaxed);
+  merged.totalTicks += histogram.totalTicks.load(std::memory_order_relaxed);
+  merged.maxTicks = std::max(
+      merged.maxTicks, histogram.maxTicks.load(std::memory_order_relaxed));
+  for (size_t i = 0; i < merged.buckets.size(); i++) {
+    merged.buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+} // namespace
+
+std::atomic<uint32_t> PipelineInstrumentation::samplePeriod_{0};
+
+void PipelineInstrumentation::setSampleRate(double fraction) {
+  uint32_t period = 0;
+  if (fraction >= 1) {
+    period = 1;
+  } else if (fraction > 0) {
+    period = static_cast<uint32_t>(std::min<double>(
+        std::round(1 / fraction), std::numeric_limits<uint32_t>::max()));
+  }
+  samplePeriod_.store(period, std::memory_order_relaxed);
+}
+
+size_t PipelineInstrumentation::registerHandler(std::string name) {
+  auto& registry = handlerRegistry();
+  std::lock_guard<std::mutex> guard(registry.mutex);
+  registry.names.push_back(std::move(name));
+  return registry.names.size() - 1;
+}
+
+void PipelineInstrumentation::record(
+    size_t handlerId,
+    Event event,
+    uint64_t ticks) {
+  auto& local = *threadHistograms();
+  if (handlerId >= local.histograms.size() || !local.histograms[handlerId]) {
+    std::lock_guard<std::mutex> guard(local.mutex);
+    if (handlerId >= local.histograms.size()) {
+      local.histograms.resize(handlerId + 1);
+    }
+    local.histograms[handlerId] = std::make_unique<HandlerHistograms>();
+  }
+  auto& histogram = (*local.histograms[handlerId])[static_cast<size_t>(event)];
+  add(histogram.count, 1);
+  add(histogram.totalTicks, ticks);
+  if (ticks > histogram.maxTicks.load(std::memory_order_relaxed)) {
+    histogram.maxTicks.store(ticks, std::memory_order_relaxed);
+  }
+  add(histogram.buckets[ticks ? folly::findLastSet(ticks) - 1 : 0], 1);
+}
+
+void PipelineInstrumentation::collect(StatsCallback& callback) {
+  std::vector<std::string> names;
+  {
+    auto& registry = handlerRegistry();
+    std::lock_guard<std::mutex> guard(registry.mutex);
+    names = registry.names;
+  }
+
+  std::vector<std::array<Histogram, kNumEvents>> merged(names.size());
+  for (auto& local : threadHistograms().accessAllThreads()) {
+    std::lock_guard<std::mutex> guard(local.mutex);
+    auto numHandlers = std::min(local.histograms.size(), merged.size());
+    for (size_t id = 0; id < numHandlers; id++) {
+      if (!local.histograms[id]) {
+        continue;
+      }
+      for (size_t event = 0; event < kNumEvents; event++) {
+        mergeInto(merged[id][event], (*local.histograms[id])[event]);
+      }
+    }
+  }
+
+  for (size_t id = 0; id < merged.size(); id++) {
+    for (size_t event = 0; event < kNumEvents; event++) {
+      if (merged[id][event].count > 0) {
+        callback.onHandlerStats(
+            names[id], static_cast<Event>(event), merged[id][event]);
+      }
+    }
+  }
+}
+
+void PipelineInstrumentation::reset() {
+  for (auto& local : threadHistograms().accessAllThreads()) {
+    std::lock_guard<std::mutex> guard(local.mutex);
+    for (auto& histograms : local.histograms) {
+      if (!histograms) {
+        continue;
+      }
+      for (auto& histogram : *histograms) {
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.totalTicks.store(0, std::memory_order_relaxed);
+        histogram.maxTicks.store(0, std::memory_order_relaxed);
+        for (auto& bucket : histogram.buckets) {
+          bucket.store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+}
+
+} // namespace wangle
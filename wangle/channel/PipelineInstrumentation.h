@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+
+#include <folly/Demangle.h>
+#include <folly/Range.h>
+#include <folly/chrono/Hardware.h>
+#include <wangle/wangle-config.h>
+
+// Builds that do not generate the option from CMake get it disabled.
+#ifndef WANGLE_PIPELINE_INSTRUMENTATION
+#define WANGLE_PIPELINE_INSTRUMENTATION 0
+#endif
+
+namespace wangle {
+
+/*
+ * PipelineInstrumentation measures how long each handler spends in read()
+ * and write(), to find the handler that eats the CPU in a long pipeline.
+ *
+ * It is compiled in only with WANGLE_PIPELINE_INSTRUMENTATION (the CMake
+ * option of the same name); otherwise the handler contexts contain no trace
+ * of it. When compiled in it is still off until setSampleRate() is called,
+ * and unsampled messages pay a few thread local updates and a relaxed
+ * atomic load.
+ *
+ * A sampled message is timed at every handler it passes through, using the
+ * TSC where available (folly::hardware_timestamp()). The time recorded for a
+ * handler excludes the time spent in the handlers it fired into, so the
+ * histograms add up to the time of the whole traversal. Samples go to per
+ * thread, per handler type histograms that collect() merges.
+ */
+class PipelineInstrumentation {
+ public:
+  enum class Event : uint8_t {
+    READ,
+    WRITE,
+  };
+
+  struct Histogram {
+    static constexpr size_t kNumBuckets = 64;
+
+    // Sampled calls; count times the sample period estimates all calls.
+    uint64_t count{0};
+    uint64_t totalTicks{0};
+    uint64_t maxTicks{0};
+    // buckets[i] counts calls that took [2^i, 2^(i+1)) ticks, buckets[0]
+    // also those that took 0.
+    std::array<uint64_t, kNumBuckets> buckets{};
+  };
+
+  class StatsCallback {
+   public:
+    virtual ~StatsCallback() = default;
+
+    // Called once per handler type and event with samples.
+    virtual void onHandlerStats(
+        folly::StringPiece handler,
+        Event event,
+        const Histogram& histogram) = 0;
+  };
+
+  // Samples this fraction of messages entering a pipeline, on each thread.
+  // 0 turns sampling off, which is the default.
+  static void setSampleRate(double fraction);
+
+  // 1 in how many messages is sampled, 0 if none.
+  static uint32_t getSamplePeriod() {
+    return samplePeriod_.load(std::memory_order_relaxed);
+  }
+
+  // Reports the histograms merged across all live threads. Samples of
+  // threads that have exited are lost.
+  static void collect(StatsCallback& callback);
+
+  // Clears the histograms of all live threads.
+  static void reset();
+
+  // The id of a handler type in the per thread histograms.
+  template <class H>
+  static size_t handlerId() {
+    static const size_t id =
+        registerHandler(folly::demangle(typeid(H)).toStdString());
+    return id;
+  }
+
+  static void record(size_t handlerId, Event event, uint64_t ticks);
+
+ private:
+  static size_t registerHandler(std::string name);
+
+  static std::atomic<uint32_t> samplePeriod_;
+};
+
+namespace detail {
+
+struct HandlerSampleState {
+  // Messages left until the next one is sampled.
+  uint32_t countdown{0};
+  // While a sampled message is in a handler, where the time it spends in
+  // handlers further down the pipeline adds up.
+  uint64_t* childTicks{nullptr};
+  // Handlers an unsampled message is in, so that its later hops are not
+  // taken for new messages.
+  uint32_t unsampledDepth{0};
+};
+
+inline HandlerSampleState& handlerSampleState() {
+  static thread_local HandlerSampleState state;
+  return state;
+}
+
+// Times one call into handler H, if the message is sampled. The disabled
+// version is empty so that the contexts compile to what they were without
+// instrumentation.
+template <class H, bool Enabled = WANGLE_PIPELINE_INSTRUMENTATION>
+class HandlerSample {
+ public:
+  explicit HandlerSample(PipelineInstrumentation::Event /*event*/) {}
+};
+
+template <class H>
+class HandlerSample<H, true> {
+ public:
+  explicit HandlerSample(PipelineInstrumentation::Event event) {
+    auto& state = handlerSampleState();
+    if (!state.childTicks) {
+      if (state.unsampledDepth > 0) {
+        state.unsampledDepth++;
+        unsampled_ = true;
+        return;
+      }
+      // Entering a pipeline, decide whether to sample this message.
+      auto period = PipelineInstrumentation::getSamplePeriod();
+      if (period == 0) {
+        return;
+      }
+      if (state.countdown > 1) {
+        state.countdown--;
+        state.unsampledDepth = 1;
+        unsampled_ = true;
+        return;
+      }
+      state.countdown = period;
+    }
+    event_ = event;
+    parentTicks_ = state.childTicks;
+    state.childTicks = &childTicks_;
+    active_ = true;
+    start_ = folly::hardware_timestamp();
+  }
+
+  ~HandlerSample() {
+    if (unsampled_) {
+      handlerSampleState().unsampledDepth--;
+    }
+    if (!active_) {
+      return;
+    }
+    uint64_t ticks = folly::hardware_timestamp() - start_;
+    handlerSampleState().childTicks = parentTicks_;
+    if (parentTicks_) {
+      *parentTicks_ += ticks;
+    }
+    PipelineInstrumentation::record(
+        PipelineInstrumentation::handlerId<H>(),
+        event_,
+        ticks > childTicks_ ? ticks - childTicks_ : 0);
+  }
+
+  HandlerSample(const HandlerSample&) = delete;
+  HandlerSample& operator=(const HandlerSample&) = delete;
+
+ private:
+  bool active_{false};
+  bool unsampled_{false};
+  PipelineInstrumentation::Event event_{PipelineInstrumentation::Event::READ};
+  uint64_t start_{0};
+  uint64_t childTicks_{0};
+  uint64_t* parentTicks_{nullptr};
+};
+
+} // namespace detail
+
+} // namespace wangle
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/channel/PipelineRecycler.h>
+
+#include <new>
+
+namespace wangle {
+
+PipelineRecycler::PipelineRecycler(size_t maxFreeBlocks)
+    : ownerThread_(std::this_thread::get_id()),
+      maxFreeBlocks_(maxFreeBlocks) {}
+
+PipelineRecycler::~PipelineRecycler() {
+  for (auto block : freeBlocks_) {
+    ::operator delete(block);
+  }
+}
+
+void* PipelineRecycler::allocate(size_t size) {
+  if (isOwnerThread()) {
+    if (blockSize_ == 0) {
+      blockSize_ = size;
+    }
+    if (size == blockSize_ && !freeBlocks_.empty()) {
+      auto block = freeBlocks_.back();
+      freeBlocks_.pop_back();
+      ++stats_.reused;
+      return block;
+    }
+    ++stats_.allocated;
+  }
+  return ::operator new(size);
+}
+
+void PipelineRecycler::deallocate(void* block, size_t size) noexcept {
+  if (isOwnerThread() && size == blockSize_ &&
+      freeBlocks_.size() < maxFreeBlocks_) {
+    try {
+      freeBlocks_.push_back(block);
+      ++stats_.recycled;
+      return;
+    } catch (const std::bad_alloc&) {
+      // Growing the free list failed; just free the block.
+    }
+  }
+  ::operator delete(block);
+}
+
+void PipelineRecycler::setMaxFreeBlocks(size_t maxFreeBlocks) {
+  maxFreeBlocks_ = maxFreeBlocks;
+  while (freeBlocks_.size() > maxFreeBlocks_) {
+    ::operator delete(freeBlocks_.back());
+    freeBlocks_.pop_back();
+  }
+}
+
+} // namespace wangle
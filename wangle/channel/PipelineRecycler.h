@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Indestructible.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseLocal.h>
+
+namespace wangle {
+
+/*
+ * PipelineRecycler keeps a free list of the memory blocks that pipelines of
+ * one type were allocated in, so that a connection setting up a pipeline
+ * reuses the block of one that was torn down instead of going to malloc.
+ *
+ * There is one recycler per pipeline type and EventBase, see get(). Blocks
+ * are only handed out and taken back on the thread that created the
+ * recycler; anywhere else, and for blocks of another size, it falls back to
+ * operator new/delete.
+ */
+class PipelineRecycler {
+ public:
+  struct Stats {
+    // Allocations served from the free list.
+    uint64_t reused{0};
+    // Allocations that went to operator new.
+    uint64_t allocated{0};
+    // Deallocations put back on the free list.
+    uint64_t recycled{0};
+  };
+
+  static constexpr size_t kDefaultMaxFreeBlocks = 1024;
+
+  explicit PipelineRecycler(size_t maxFreeBlocks = kDefaultMaxFreeBlocks);
+  ~PipelineRecycler();
+
+  PipelineRecycler(const PipelineRecycler&) = delete;
+  PipelineRecycler& operator=(const PipelineRecycler&) = delete;
+
+  // The recycler for pipelines of type P on evb, created on first use. Must
+  // be called from evb's thread.
+  template <class P>
+  static std::shared_ptr<PipelineRecycler> get(folly::EventBase& evb) {
+    static folly::Indestructible<
+        folly::EventBaseLocal<std::shared_ptr<PipelineRecycler>>>
+        recyclers;
+    auto& recycler = recyclers->getOrCreate(evb);
+    if (!recycler) {
+      recycler = std::make_shared<PipelineRecycler>();
+    }
+    return recycler;
+  }
+
+  void* allocate(size_t size);
+  void deallocate(void* block, size_t size) noexcept;
+
+  void setMaxFreeBlocks(size_t maxFreeBlocks);
+
+  size_t numFreeBlocks() const {
+    return freeBlocks_.size();
+  }
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  bool isOwnerThread() const {
+    return std::this_thread::get_id() == ownerThread_;
+  }
+
+  const std::thread::id ownerThread_;
+  size_t maxFreeBlocks_;
+  // Size of the blocks on the free list, set by the first allocation.
+  size_t blockSize_{0};
+  std::vector<void*> freeBlocks_;
+  Stats stats_;
+};
+
+/*
+ * Standard allocator drawing from a PipelineRecycler, for use with
+ * std::allocate_shared so that a pipeline and its shared_ptr control block
+ * share one recycled block. The allocator copy kept in the control block
+ * holds a reference to the recycler, so pipelines may outlive the
+ * EventBase.
+ */
+template <class T>
+class PipelineRecyclingAllocator {
+ public:
+  using value_type = T;
+
+  explicit PipelineRecyclingAllocator(
+      std::shared_ptr<PipelineRecycler> recycler)
+      : recycler_(std::move(recycler)) {}
+
+  template <class U>
+  /* implicit */ PipelineRecyclingAllocator(
+      const PipelineRecyclingAllocator<U>& other)
+      : recycler_(other.recycler_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(recycler_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    recycler_->deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  bool operator==(const PipelineRecyclingAllocator<U>& other) const {
+    return recycler_ == other.recycler_;
+  }
+
+  template <class U>
+  bool operator!=(const PipelineRecyclingAllocator<U>& other) const {
+    return recycler_ != other.recycler_;
+  }
+
+ private:
+  template <class U>
+  friend class PipelineRecyclingAllocator;
+
+  std::shared_ptr<PipelineRecycler> recycler_;
+};
+
+} // namespace wangle
@@ -19,6 +19,7 @@
 #include <type_traits>
 
 #include <wangle/channel/Pipeline.h>
+#include <wangle/channel/PipelineRecycler.h>
 #include <wangle/util/Logging.h>
 
 namespace wangle {
@@ -43,6 +44,11 @@ namespace wangle {
  * pipeline;
  *
  * You can then use pipeline just like any Pipeline. See Pipeline.h.
+ *
+ * The pipeline, its contexts and the handlers passed by value share a single
+ * allocation. createRecycled() additionally places the shared_ptr control
+ * block in that allocation and reuses the blocks of torn down pipelines of
+ * the same type on the same EventBase, see PipelineRecycler.
  */
 template <class R, class W, class... Handlers>
 class StaticPipeline;
@@ -83,6 +89,28 @@ class StaticPipeline<R, W, Handler, Handlers...>
     return ptr;
   }
 
+  // Must be called from evb's thread, e.g. in PipelineFactory::newPipeline().
+  template <class... HandlerArgs>
+  static Ptr createRecycled(folly::EventBase& evb, HandlerArgs&&... handlers) {
+    auto ptr = std::allocate_shared<StaticPipeline>(
+        PipelineRecyclingAllocator<StaticPipeline>(
+            PipelineRecycler::get<StaticPipeline>(evb)),
+        CreateKey(),
+        std::forward<HandlerArgs>(handlers)...);
+    ptr->initialize();
+    return ptr;
+  }
+
+  class CreateKey {
+    CreateKey() {}
+    friend StaticPipeline;
+  };
+
+  // For std::allocate_shared() in createRecycled().
+  template <class... HandlerArgs>
+  StaticPipeline(CreateKey, HandlerArgs&&... handlers)
+      : StaticPipeline(std::forward<HandlerArgs>(handlers)...) {}
+
   ~StaticPipeline() override {
     if (isFirst_) {
       Pipeline<R, W>::detachHandlers();
@@ -103,11 +131,14 @@ class StaticPipeline<R, W, Handler, Handlers...>
             std::forward<HandlerArgs>(handlers)...) {
     isFirst_ = isFirst;
     setHandler(std::forward<HandlerArg>(handler));
-    Pipeline<R, W>::addContextFront(&ctx_);
   }
 
   void initialize() {
     WANGLE_CHECK(handlerPtr_);
+    if (isFirst_) {
+      Pipeline<R, W>::reserveContexts(sizeof...(Handlers) + 1);
+    }
+    Pipeline<R, W>::addContextBack(&ctx_);
     ctx_.initialize(Pipeline<R, W>::shared_from_this(), handlerPtr_);
     StaticPipeline<R, W, Handlers...>::initialize();
   }
@@ -119,8 +150,7 @@ class StaticPipeline<R, W, Handler, Handlers...>
       Handler>::value>::type
   setHandler(HandlerArg&& arg) {
     BaseWithOptional<Handler>::handler_.emplace(std::forward<HandlerArg>(arg));
-    handlerPtr_ = std::shared_ptr<Handler>(
-        &(*BaseWithOptional<Handler>::handler_), [](Handler*) {});
+    handlerPtr_ = detail::nonOwningPtr(&(*BaseWithOptional<Handler>::handler_));
   }
 
   template <class HandlerArg>
@@ -136,7 +166,7 @@ class StaticPipeline<R, W, Handler, Handlers...>
       std::is_same<typename std::decay<HandlerArg>::type, Handler*>::value>::
       type
       setHandler(HandlerArg&& arg) {
-    handlerPtr_ = std::shared_ptr<Handler>(arg, [](Handler*) {});
+    handlerPtr_ = detail::nonOwningPtr(arg);
   }
 
   bool isFirst_;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/channel/WriteFlushScheduler.h>
+
+#include <folly/Indestructible.h>
+#include <folly/io/async/EventBaseLocal.h>
+#include <wangle/util/Logging.h>
+
+namespace wangle {
+
+WriteFlushScheduler& WriteFlushScheduler::get(folly::EventBase& evb) {
+  static folly::Indestructible<folly::EventBaseLocal<WriteFlushScheduler>>
+      schedulers;
+  auto& scheduler = schedulers->getOrCreate(evb);
+  scheduler.evb_ = &evb;
+  return scheduler;
+}
+
+void WriteFlushScheduler::schedule(Flushable& flushable) {
+  WANGLE_DCHECK(evb_);
+  ++stats_.writesScheduled;
+  if (flushable.isFlushScheduled()) {
+    return;
+  }
+  dirty_.push_back(flushable);
+  if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void WriteFlushScheduler::setFlushBudget(size_t budget) {
+  WANGLE_CHECK_GT(budget, 0);
+  flushBudget_ = budget;
+}
+
+void WriteFlushScheduler::runLoopCallback() noexcept {
+  ++stats_.flushPasses;
+  // Pipelines that write again while being flushed requeue themselves for
+  // the next pass rather than extending this one.
+  FlushQueue pending;
+  pending.swap(dirty_);
+  size_t flushed = 0;
+  while (!pending.empty() && flushed < flushBudget_) {
+    auto& flushable = pending.front();
+    pending.pop_front();
+    ++flushed;
+    flushable.flushWrites();
+  }
+  stats_.pipelinesFlushed += flushed;
+
+  if (!pending.empty()) {
+    stats_.pipelinesDeferred += pending.size();
+    dirty_.splice(dirty_.begin(), pending);
+  }
+  if (!dirty_.empty()) {
+    evb_->runInLoop(this);
+  }
+}
+
+} // namespace wangle
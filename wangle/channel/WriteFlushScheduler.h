@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/io/async/EventBase.h>
+
+namespace wangle {
+
+/*
+ * WriteFlushScheduler coalesces the end-of-loop flushes of every pipeline on
+ * an EventBase into a single loop callback. Pipelines with buffered writes
+ * schedule themselves once per loop iteration; the callback then flushes the
+ * dirty ones in FIFO order, at most flushBudget per pass, leaving the rest for
+ * the next iteration.
+ *
+ * Must only be used from the EventBase thread.
+ */
+class WriteFlushScheduler : private folly::EventBase::LoopCallback {
+ public:
+  class Flushable {
+   public:
+    virtual ~Flushable() = default;
+
+    virtual void flushWrites() noexcept = 0;
+
+    bool isFlushScheduled() const {
+      return flushHook_.is_linked();
+    }
+
+    void cancelFlush() {
+      flushHook_.unlink();
+    }
+
+   private:
+    friend class WriteFlushScheduler;
+    // Auto-unlinking, so a destroyed Flushable leaves the queue by itself.
+    folly::IntrusiveListHook flushHook_;
+  };
+
+  struct Stats {
+    // schedule() calls, i.e. writes buffered by the scheduled pipelines.
+    uint64_t writesScheduled{0};
+    // Loop callbacks that ran.
+    uint64_t flushPasses{0};
+    // Pipelines flushed across all passes.
+    uint64_t pipelinesFlushed{0};
+    // Pipelines left over for the next pass by the budget.
+    uint64_t pipelinesDeferred{0};
+  };
+
+  static constexpr size_t kDefaultFlushBudget = 1024;
+
+  // The scheduler of the given EventBase, created on first use.
+  static WriteFlushScheduler& get(folly::EventBase& evb);
+
+  // Queues flushable for the end of the current loop iteration, unless it is
+  // already queued.
+  void schedule(Flushable& flushable);
+
+  void setFlushBudget(size_t budget);
+
+  size_t getFlushBudget() const {
+    return flushBudget_;
+  }
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  void runLoopCallback() noexcept override;
+
+  using FlushQueue = folly::IntrusiveList<Flushable, &Flushable::flushHook_>;
+
+  folly::EventBase* evb_{nullptr};
+  FlushQueue dirty_;
+  size_t flushBudget_{kDefaultFlushBudget};
+  Stats stats_;
+};
+
+} // namespace wangle
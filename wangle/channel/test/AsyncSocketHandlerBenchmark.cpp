@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/net/NetOps.h>
+#include <wangle/channel/AsyncSocketHandler.h>
+#include <wangle/channel/Pipeline.h>
+#include <wangle/util/Logging.h>
+
+using namespace folly;
+using namespace wangle;
+
+namespace {
+
+constexpr size_t kConnections = 100;
+
+// Consumes all but the last keep bytes of every read, like a decoder left
+// holding the start of the next frame.
+class FrameConsumer : public InboundBytesToBytesHandler {
+ public:
+  FrameConsumer(size_t* reads, size_t keep) : reads_(reads), keep_(keep) {}
+
+  void read(Context*, IOBufQueue& q) override {
+    q.trimStart(q.chainLength() - std::min(keep_, q.chainLength()));
+    ++*reads_;
+  }
+
+ private:
+  size_t* reads_;
+  size_t keep_;
+};
+
+struct Connection {
+  std::shared_ptr<AsyncSocket> writer;
+  DefaultPipeline::Ptr pipeline;
+};
+
+// Sends one small message to each of kConnections idle connections per
+// iteration, then reports how much read buffer memory every connection
+// keeps allocated while it waits for the next message, with keep bytes of
+// a partial frame queued.
+void idleConnections(
+    UserCounters& counters,
+    size_t iters,
+    bool release,
+    size_t keep) {
+  BenchmarkSuspender suspender;
+  EventBase evb;
+  size_t reads = 0;
+  std::vector<Connection> conns(kConnections);
+  for (auto& conn : conns) {
+    NetworkSocket fds[2];
+    WANGLE_CHECK_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    conn.writer = AsyncSocket::newSocket(&evb, fds[0]);
+    conn.pipeline = DefaultPipeline::create();
+    conn.pipeline->addBack(
+        AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+    conn.pipeline->addBack(FrameConsumer(&reads, keep));
+    conn.pipeline->finalize();
+    conn.pipeline->getHandler<AsyncSocketHandler>()
+        ->setReleaseIdleReadBuffers(release);
+    conn.pipeline->transportActive();
+  }
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    for (auto& conn : conns) {
+      conn.writer->write(nullptr, "ping", 4);
+    }
+    const auto target = reads + kConnections;
+    while (reads < target) {
+      evb.loopOnce();
+    }
+  }
+
+  suspender.rehire();
+  size_t capacity = 0;
+  for (auto& conn : conns) {
+    auto handler = conn.pipeline->getHandler<AsyncSocketHandler>();
+    capacity += handler->getReadBufferCapacity();
+    conn.pipeline->close();
+  }
+  counters["idle_bytes_per_conn"] = capacity / kConnections;
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(PreallocatedReadBuffers_PartialFrame, counters, iters) {
+  idleConnections(counters, iters, false, 1);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(
+    ReleasedIdleReadBuffers_PartialFrame,
+    counters,
+    iters) {
+  idleConnections(counters, iters, true, 1);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Nothing stays queued, so neither mode keeps a buffer; this compares the
+// cost of allocating a buffer per read against copying out of the scratch
+// buffer.
+BENCHMARK_COUNTERS(PreallocatedReadBuffers_EmptyQueue, counters, iters) {
+  idleConnections(counters, iters, false, 0);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(
+    ReleasedIdleReadBuffers_EmptyQueue,
+    counters,
+    iters) {
+  idleConnections(counters, iters, true, 0);
+}
+
+int main(int argc, char** argv) {
+  const folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
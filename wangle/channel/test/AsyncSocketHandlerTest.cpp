@@ -14,11 +14,15 @@
  * limitations under the License.
  */
 
+#include <cstring>
+
+#include <folly/net/NetOps.h>
 #include <folly/portability/GTest.h>
 #include <wangle/channel/AsyncSocketHandler.h>
 #include <wangle/channel/Pipeline.h>
 #include <wangle/channel/test/MockHandler.h>
 #include <wangle/channel/test/MockPipeline.h>
+#include <wangle/codec/LengthFieldBasedFrameDecoder.h>
 
 using namespace folly;
 using namespace testing;
@@ -83,3 +87,398 @@ TEST(AsyncSocketHandlerTest, TransportActiveInactive) {
   EXPECT_CALL(*handler, transportInactive(_)).Times(0);
   pipeline->close();
 }
+
+TEST(AsyncSocketHandlerTest, FireAndForgetWriteOnClosedSocket) {
+  EventBase evb;
+  auto socket = AsyncSocket::newSocket(&evb);
+  auto handler = std::make_shared<StrictMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(std::move(socket)));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  pipeline->getHandler<AsyncSocketHandler>()->setFireAndForgetWrites(true);
+
+  // The write error is delivered inbound instead of through a Future.
+  EXPECT_CALL(*handler, readException(_, _)).Times(1);
+  auto f = pipeline->write(IOBuf::copyBuffer("hello"));
+  EXPECT_FALSE(f.valid());
+
+  EXPECT_CALL(*handler, mockClose(_))
+      .WillOnce(Return(handler->defaultFuture()));
+  pipeline->close();
+}
+
+TEST(AsyncSocketHandlerTest, WriteCallbacksReused) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto reader = AsyncSocket::newSocket(&evb, fds[1]);
+
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[0])));
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+  EXPECT_EQ(0, socketHandler->getNumFreeWriteCallbacks());
+
+  // Small writes complete right away, each returning its callback before
+  // the next write takes it again.
+  for (int i = 0; i < 100; i++) {
+    auto f = pipeline->write(IOBuf::copyBuffer("hello"));
+    EXPECT_TRUE(f.isReady());
+    EXPECT_EQ(1, socketHandler->getNumFreeWriteCallbacks());
+  }
+  for (bool fireAndForget : {true, false}) {
+    socketHandler->setFireAndForgetWrites(fireAndForget);
+    pipeline->write(IOBuf::copyBuffer("hello"));
+    EXPECT_EQ(1, socketHandler->getNumFreeWriteCallbacks());
+  }
+  pipeline->close();
+}
+
+TEST(AsyncSocketHandlerTest, WriteCallbackFreeListCapped) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[0])));
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+
+  // Nobody is reading yet, so these writes are all in flight at once.
+  std::vector<Future<Unit>> futures;
+  futures.push_back(
+      pipeline->write(IOBuf::copyBuffer(std::string(8 << 20, 'x'))));
+  for (int i = 0; i < 31; i++) {
+    futures.push_back(pipeline->write(IOBuf::copyBuffer("hello")));
+  }
+  EXPECT_EQ(0, socketHandler->getNumFreeWriteCallbacks());
+
+  auto reader = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  ON_CALL(*reader, read(_, _)).WillByDefault(Invoke([](auto*, auto& q) {
+    q.move();
+  }));
+  auto readerPipeline = DefaultPipeline::create();
+  readerPipeline->addBack(
+      AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+  readerPipeline->addBack(reader);
+  readerPipeline->finalize();
+  readerPipeline->transportActive();
+  while (!futures.back().isReady()) {
+    evb.loopOnce();
+  }
+  for (auto& f : futures) {
+    EXPECT_TRUE(f.hasValue());
+  }
+  EXPECT_EQ(16, socketHandler->getNumFreeWriteCallbacks());
+}
+
+TEST(AsyncSocketHandlerTest, WriteCallbacksOrphanedOnDestroy) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto reader = AsyncSocket::newSocket(&evb, fds[1]);
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb, fds[0]);
+
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(socket));
+  pipeline->finalize();
+  pipeline->getHandler<AsyncSocketHandler>()->setFireAndForgetWrites(true);
+  pipeline->write(IOBuf::copyBuffer(std::string(8 << 20, 'x')));
+  pipeline->getHandler<AsyncSocketHandler>()->setFireAndForgetWrites(false);
+  auto f = pipeline->write(IOBuf::copyBuffer("hello"));
+  EXPECT_FALSE(f.isReady());
+
+  // The socket outlives the handler and its callback pool, so the pending
+  // writes fail into callbacks that have to clean up after themselves.
+  pipeline.reset();
+  socket->closeNow();
+  ASSERT_TRUE(f.isReady());
+  EXPECT_TRUE(f.hasException());
+}
+
+TEST(AsyncSocketHandlerTest, WritabilityChanged) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+  auto handler = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[0])));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  pipeline->setWriteBufferWatermarks(16 * 1024, 64 * 1024);
+
+  auto reader = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  ON_CALL(*reader, read(_, _)).WillByDefault(Invoke([](auto*, auto& q) {
+    q.move();
+  }));
+  auto readerPipeline = DefaultPipeline::create();
+  readerPipeline->addBack(
+      AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+  readerPipeline->addBack(reader);
+  readerPipeline->finalize();
+
+  // Nobody is reading yet, so most of this stays buffered in the socket.
+  EXPECT_CALL(*handler, writabilityChanged(_, false));
+  auto f = pipeline->write(IOBuf::copyBuffer(std::string(8 << 20, 'x')));
+  Mock::VerifyAndClearExpectations(handler.get());
+
+  bool writable = false;
+  EXPECT_CALL(*handler, writabilityChanged(_, true))
+      .WillOnce(Assign(&writable, true));
+  readerPipeline->transportActive();
+  while (!writable) {
+    evb.loopOnce();
+  }
+  EXPECT_TRUE(f.isReady());
+}
+
+TEST(AsyncSocketHandlerTest, ReadEnabled) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto writer = AsyncSocket::newSocket(&evb, fds[0]);
+
+  auto handler = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  pipeline->transportActive();
+
+  // Pausing from a handler must not look like the transport going away.
+  EXPECT_CALL(*handler, transportInactive(_)).Times(0);
+  EXPECT_CALL(*handler, read(_, _)).Times(0);
+  handler->getContext()->setReadEnabled(false);
+  writer->write(nullptr, "hello", 5);
+  evb.loop();
+  Mock::VerifyAndClearExpectations(handler.get());
+
+  bool read = false;
+  EXPECT_CALL(*handler, read(_, _)).WillOnce(Invoke([&](auto*, auto& q) {
+    EXPECT_EQ("hello", q.move()->moveToFbString());
+    read = true;
+  }));
+  handler->getContext()->setReadEnabled(true);
+  while (!read) {
+    evb.loopOnce();
+  }
+}
+
+TEST(AdaptiveReadBufferSizerTest, GrowAndShrink) {
+  AdaptiveReadBufferSizer sizer(512, 8192, 2048);
+  EXPECT_EQ(2048, sizer.getAllocationSize());
+
+  // A full buffer grows the next allocation right away, up to the max.
+  sizer.record(2048, 2048);
+  EXPECT_EQ(4096, sizer.getAllocationSize());
+  sizer.record(4096, 4096);
+  sizer.record(8192, 8192);
+  EXPECT_EQ(8192, sizer.getAllocationSize());
+
+  // Shrinking needs two small reads in a row, and stops at the min.
+  sizer.record(100, 8192);
+  EXPECT_EQ(8192, sizer.getAllocationSize());
+  sizer.record(100, 8192);
+  EXPECT_EQ(4096, sizer.getAllocationSize());
+  sizer.record(100, 4096);
+  sizer.record(3000, 4096);
+  sizer.record(100, 4096);
+  EXPECT_EQ(4096, sizer.getAllocationSize());
+  for (int i = 0; i < 10; i++) {
+    sizer.record(1, 4096);
+  }
+  EXPECT_EQ(512, sizer.getAllocationSize());
+}
+
+TEST(AsyncSocketHandlerTest, ReadBufferStats) {
+  EventBase evb;
+  NetworkSocket fds[2];
+  ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto writer = AsyncSocket::newSocket(&evb, fds[0]);
+
+  auto handler = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+  socketHandler->setAdaptiveReadBufferSizing(64, 4096);
+  pipeline->transportActive();
+
+  bool read = false;
+  EXPECT_CALL(*handler, read(_, _)).WillOnce(Invoke([&](auto*, auto& q) {
+    q.move();
+    read = true;
+  }));
+  writer->write(nullptr, "hello", 5);
+  while (!read) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(1, socketHandler->getReadBufferStats().numReads);
+  EXPECT_EQ(5, socketHandler->getReadBufferStats().bytesRead);
+  EXPECT_DOUBLE_EQ(5.0, socketHandler->getReadBufferStats().averageReadSize());
+}
+
+TEST(AsyncSocketHandlerTest, ReleaseIdleReadBuffers) {
+  for (bool release : {false, true}) {
+    EventBase evb;
+    NetworkSocket fds[2];
+    ASSERT_EQ(0, netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    auto writer = AsyncSocket::newSocket(&evb, fds[0]);
+
+    auto handler = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+    auto pipeline = DefaultPipeline::create();
+    pipeline->addBack(
+        AsyncSocketHandler(AsyncSocket::newSocket(&evb, fds[1])));
+    pipeline->addBack(handler);
+    pipeline->finalize();
+    auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+    socketHandler->setReleaseIdleReadBuffers(release);
+    pipeline->transportActive();
+
+    // Leave a partial frame queued, as a decoder waiting for more data would.
+    bool read = false;
+    EXPECT_CALL(*handler, read(_, _)).WillOnce(Invoke([&](auto*, auto& q) {
+      q.trimStart(q.chainLength() - 1);
+      read = true;
+    }));
+    writer->write(nullptr, "hello", 5);
+    while (!read) {
+      evb.loopOnce();
+    }
+    auto settings = pipeline->getReadBufferSettings();
+    if (release) {
+      EXPECT_GT(settings.first, socketHandler->getReadBufferCapacity());
+    } else {
+      EXPECT_LE(settings.first, socketHandler->getReadBufferCapacity());
+    }
+    pipeline->close();
+  }
+}
+
+TEST(AsyncSocketHandlerTest, ReleaseIdleReadBuffersOnlyWhileIdle) {
+  EventBase evb;
+  auto handler = std::make_shared<NiceMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb)));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+  socketHandler->setReleaseIdleReadBuffers(true);
+
+  bool keepPartialFrame = false;
+  ON_CALL(*handler, read(_, _)).WillByDefault(Invoke([&](auto*, auto& q) {
+    q.trimStart(q.chainLength() - (keepPartialFrame ? 1 : 0));
+  }));
+  void* buf = nullptr;
+  size_t len = 0;
+
+  // An idle connection reads into the shared scratch buffer.
+  socketHandler->getReadBuffer(&buf, &len);
+  void* const scratch = buf;
+  const size_t scratchLen = len;
+
+  // A read that fills it means traffic is flowing, so the next read goes
+  // into a preallocated buffer.
+  socketHandler->readDataAvailable(scratchLen);
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_NE(scratch, buf);
+
+  // A short read leaving nothing queued goes back to the scratch buffer.
+  socketHandler->readDataAvailable(10);
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_EQ(scratch, buf);
+
+  // A partial frame that a short read leaves in a preallocated buffer is
+  // copied out of it, and the next read goes into the scratch buffer.
+  socketHandler->readDataAvailable(len);
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_NE(scratch, buf);
+  keepPartialFrame = true;
+  socketHandler->readDataAvailable(10);
+  const auto settings = pipeline->getReadBufferSettings();
+  EXPECT_GT(settings.first, socketHandler->getReadBufferCapacity());
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_EQ(scratch, buf);
+
+  // Further short reads are packed behind it.
+  socketHandler->readDataAvailable(10);
+  EXPECT_GT(settings.first, socketHandler->getReadBufferCapacity());
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_EQ(scratch, buf);
+}
+
+TEST(AsyncSocketHandlerTest, MovableReadBuffers) {
+  EventBase evb;
+  auto handler = std::make_shared<StrictMock<MockBytesToBytesHandler>>();
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb)));
+  pipeline->addBack(handler);
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+  EXPECT_FALSE(socketHandler->isBufferMovable());
+  socketHandler->setMovableReadBuffers(true);
+  EXPECT_TRUE(socketHandler->isBufferMovable());
+
+  auto buf = IOBuf::copyBuffer("hello");
+  const auto data = buf->data();
+  EXPECT_CALL(*handler, read(_, _)).WillOnce(Invoke([&](auto*, auto& q) {
+    // Handed off as is, without copying into a preallocated buffer.
+    EXPECT_EQ(data, q.front()->data());
+    EXPECT_EQ(5, q.chainLength());
+    q.move();
+  }));
+  socketHandler->readBufferAvailable(std::move(buf));
+  EXPECT_EQ(1, socketHandler->getReadBufferStats().numReads);
+  EXPECT_EQ(5, socketHandler->getReadBufferStats().bytesRead);
+}
+
+TEST(AsyncSocketHandlerTest, ReadBytesExpected) {
+  EventBase evb;
+  auto pipeline = DefaultPipeline::create();
+  pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb)));
+  pipeline->finalize();
+  auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+
+  void* buf = nullptr;
+  size_t len = 0;
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_GE(len, pipeline->getReadBufferSettings().first);
+  EXPECT_LT(len, 100000);
+
+  // The rest of a large frame fits in the next read buffer.
+  pipeline->setReadBytesExpected(100000);
+  socketHandler->getReadBuffer(&buf, &len);
+  EXPECT_GE(len, 100000);
+}
+
+TEST(AsyncSocketHandlerTest, ReadBytesExpectedIsBounded) {
+  for (bool adaptive : {false, true}) {
+    EventBase evb;
+    auto pipeline = DefaultPipeline::create();
+    pipeline->addBack(AsyncSocketHandler(AsyncSocket::newSocket(&evb)));
+    pipeline->addBack(LengthFieldBasedFrameDecoder());
+    pipeline->finalize();
+    auto socketHandler = pipeline->getHandler<AsyncSocketHandler>();
+    if (adaptive) {
+      socketHandler->setAdaptiveReadBufferSizing(64, 4096);
+    }
+
+    // A header claiming a 1 GiB frame, with nothing after it, must not make
+    // the connection allocate a buffer for all of it.
+    void* buf = nullptr;
+    size_t len = 0;
+    socketHandler->getReadBuffer(&buf, &len);
+    const uint8_t header[] = {0x40, 0, 0, 0};
+    std::memcpy(buf, header, sizeof(header));
+    socketHandler->readDataAvailable(sizeof(header));
+    EXPECT_EQ(uint64_t(1) << 30, pipeline->getReadBytesExpected());
+
+    socketHandler->getReadBuffer(&buf, &len);
+    EXPECT_LT(
+        socketHandler->getReadBufferCapacity(),
+        adaptive ? 16 * 1024 : 1024 * 1024);
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <wangle/channel/EventBaseHandler.h>
+#include <wangle/channel/StaticPipeline.h>
+#include <wangle/channel/test/MockHandler.h>
+
+using namespace folly;
+using namespace wangle;
+using namespace testing;
+
+using MockBytesHandler =
+    StrictMock<MockHandlerAdapter<IOBufQueue&, std::unique_ptr<IOBuf>>>;
+
+MATCHER_P(IOBufContains, str, "") {
+  return arg->moveToFbString() == str;
+}
+
+TEST(AsyncEventBaseHandlerTest, BatchesCrossThreadWrites) {
+  MockBytesHandler mockHandler;
+  EXPECT_CALL(mockHandler, attachPipeline(_));
+  auto pipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      MockBytesHandler,
+      AsyncEventBaseHandler>::create(&mockHandler, AsyncEventBaseHandler());
+
+  ScopedEventBaseThread evbThread;
+  auto evb = evbThread.getEventBase();
+  evb->runInEventBaseThreadAndWait(
+      [&] { pipeline->setTransport(AsyncSocket::newSocket(evb)); });
+
+  // Hold the EventBase so that both writes are queued before it drains.
+  Baton<> blocked;
+  evb->runInEventBaseThread([&] { blocked.wait(); });
+  auto f1 = pipeline->write(IOBuf::copyBuffer("hello"));
+  auto f2 = pipeline->write(IOBuf::copyBuffer("world"));
+  EXPECT_FALSE(f1.isReady());
+  EXPECT_FALSE(f2.isReady());
+
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("helloworld")));
+  blocked.post();
+  std::move(f1).get();
+  std::move(f2).get();
+
+  EXPECT_CALL(mockHandler, detachPipeline(_));
+  evb->runInEventBaseThreadAndWait([&] { pipeline.reset(); });
+}
+
+namespace {
+
+// Returns empty Futures, like AsyncSocketHandler with fire-and-forget writes.
+class FireAndForgetSink : public OutboundBytesToBytesHandler {
+ public:
+  Future<Unit> write(Context*, std::unique_ptr<IOBuf> buf) override {
+    written += buf->moveToFbString().toStdString();
+    return Future<Unit>::makeEmpty();
+  }
+
+  std::string written;
+};
+
+} // namespace
+
+TEST(AsyncEventBaseHandlerTest, FireAndForgetWrites) {
+  FireAndForgetSink sink;
+  auto pipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      FireAndForgetSink,
+      AsyncEventBaseHandler>::create(&sink, AsyncEventBaseHandler());
+
+  ScopedEventBaseThread evbThread;
+  auto evb = evbThread.getEventBase();
+  evb->runInEventBaseThreadAndWait(
+      [&] { pipeline->setTransport(AsyncSocket::newSocket(evb)); });
+
+  // The queued writes complete once they are handed off in one batch.
+  Baton<> blocked;
+  evb->runInEventBaseThread([&] { blocked.wait(); });
+  auto f1 = pipeline->write(IOBuf::copyBuffer("hello"));
+  auto f2 = pipeline->write(IOBuf::copyBuffer("world"));
+  blocked.post();
+  std::move(f1).get();
+  std::move(f2).get();
+  evb->runInEventBaseThreadAndWait([&] {
+    EXPECT_EQ("helloworld", sink.written);
+    pipeline.reset();
+  });
+}
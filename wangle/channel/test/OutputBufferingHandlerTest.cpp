@@ -65,3 +65,100 @@ TEST(OutputBufferingHandlerTest, Basic) {
   EXPECT_TRUE(f.isReady());
   pipeline.reset();
 }
+
+TEST(OutputBufferingHandlerTest, FlushThresholds) {
+  MockBytesHandler mockHandler;
+  EXPECT_CALL(mockHandler, attachPipeline(_));
+  OutputBufferingHandler buffering;
+  buffering.setFlushThresholds(10, 0);
+  auto pipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      MockBytesHandler,
+      OutputBufferingHandler>::create(&mockHandler, std::move(buffering));
+
+  EventBase eb;
+  pipeline->setTransport(AsyncSocket::newSocket(&eb));
+
+  // Reaching the byte threshold flushes without waiting for the loop.
+  auto f1 = pipeline->write(IOBuf::copyBuffer("hello"));
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("helloworld")));
+  auto f2 = pipeline->write(IOBuf::copyBuffer("world"));
+  EXPECT_TRUE(f1.isReady());
+  EXPECT_TRUE(f2.isReady());
+
+  pipeline->getHandler<OutputBufferingHandler>()->setFlushThresholds(0, 2);
+  auto f3 = pipeline->write(IOBuf::copyBuffer("foo"));
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("foobar")));
+  auto f4 = pipeline->write(IOBuf::copyBuffer("bar"));
+  EXPECT_TRUE(f3.isReady());
+  EXPECT_TRUE(f4.isReady());
+  EXPECT_CALL(mockHandler, detachPipeline(_));
+  pipeline.reset();
+}
+
+TEST(OutputBufferingHandlerTest, CorkEarlyFlushes) {
+  MockBytesHandler mockHandler;
+  EXPECT_CALL(mockHandler, attachPipeline(_));
+  OutputBufferingHandler buffering;
+  buffering.setFlushThresholds(10, 0);
+  buffering.setCorkEarlyFlushes(true);
+  auto pipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      MockBytesHandler,
+      OutputBufferingHandler>::create(&mockHandler, std::move(buffering));
+
+  EventBase eb;
+  pipeline->setTransport(AsyncSocket::newSocket(&eb));
+
+  // The write crossing the threshold is held for the final, uncorked flush.
+  // CORK is only passed for the corked write, not set on the pipeline where
+  // any other write would pick it up.
+  auto f1 = pipeline->write(IOBuf::copyBuffer("hello"));
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("hello")))
+      .WillOnce(InvokeWithoutArgs([&] {
+        EXPECT_FALSE(
+            isSet(pipeline->getWriteFlags(), folly::WriteFlags::CORK));
+        EXPECT_TRUE(
+            isSet(pipeline->takeNextWriteFlags(), folly::WriteFlags::CORK));
+        EXPECT_FALSE(
+            isSet(pipeline->takeNextWriteFlags(), folly::WriteFlags::CORK));
+      }));
+  auto f2 = pipeline->write(IOBuf::copyBuffer("world"));
+  EXPECT_TRUE(f1.isReady());
+  EXPECT_FALSE(f2.isReady());
+  EXPECT_FALSE(isSet(pipeline->getWriteFlags(), folly::WriteFlags::CORK));
+
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("world")))
+      .WillOnce(InvokeWithoutArgs([&] {
+        EXPECT_FALSE(
+            isSet(pipeline->takeNextWriteFlags(), folly::WriteFlags::CORK));
+      }));
+  eb.loopOnce();
+  EXPECT_TRUE(f2.isReady());
+  EXPECT_CALL(mockHandler, detachPipeline(_));
+  pipeline.reset();
+}
+
+TEST(OutputBufferingHandlerTest, FireAndForgetWrites) {
+  MockBytesHandler mockHandler;
+  EXPECT_CALL(mockHandler, attachPipeline(_));
+  OutputBufferingHandler buffering;
+  buffering.setFireAndForgetWrites(true);
+  auto pipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      MockBytesHandler,
+      OutputBufferingHandler>::create(&mockHandler, std::move(buffering));
+
+  EventBase eb;
+  pipeline->setTransport(AsyncSocket::newSocket(&eb));
+
+  EXPECT_FALSE(pipeline->write(IOBuf::copyBuffer("hello")).valid());
+  EXPECT_FALSE(pipeline->write(IOBuf::copyBuffer("world")).valid());
+  EXPECT_CALL(mockHandler, write_(_, IOBufContains("helloworld")));
+  eb.loopOnce();
+  EXPECT_CALL(mockHandler, detachPipeline(_));
+  pipeline.reset();
+}
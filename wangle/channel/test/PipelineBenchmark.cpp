@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utility>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/Request.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/channel/LinkedStaticPipeline.h>
+#include <wangle/channel/Pipeline.h>
+#include <wangle/channel/StaticPipeline.h>
+
+using namespace wangle;
+using folly::Unit;
+
+/*
+ * Every read benchmark sends one message through n pass-through handlers
+ * into a sink, and every write benchmark sends one message through n
+ * pass-through handlers into a sink that completes the write, so the time per
+ * iteration is the cost per message. Comparing n = 1 to n = 16 gives the cost
+ * of a handler hop.
+ */
+
+namespace {
+
+class InboundPassThrough : public InboundHandler<int> {
+ public:
+  void read(Context* ctx, int msg) override {
+    ctx->fireRead(msg);
+  }
+};
+
+class OutboundPassThrough : public OutboundHandler<int> {
+ public:
+  folly::Future<Unit> write(Context* ctx, int msg) override {
+    return ctx->fireWrite(msg);
+  }
+};
+
+// HandlerAdapter forwards in both directions.
+using ReadPassThrough = HandlerAdapter<int, Unit>;
+using WritePassThrough = HandlerAdapter<Unit, int>;
+
+class ReadSink : public InboundHandler<int> {
+ public:
+  void read(Context*, int msg) override {
+    folly::doNotOptimizeAway(msg);
+  }
+};
+
+class WriteSink : public OutboundHandler<int> {
+ public:
+  folly::Future<Unit> write(Context*, int msg) override {
+    folly::doNotOptimizeAway(msg);
+    return folly::makeFuture();
+  }
+};
+
+template <class T, size_t>
+using Repeat = T;
+
+template <template <class, class, class...> class P, class H, class Indices>
+struct ReadChain;
+
+// n handlers followed by a ReadSink.
+template <template <class, class, class...> class P, class H, size_t... Is>
+struct ReadChain<P, H, std::index_sequence<Is...>> {
+  using Type = P<int, Unit, Repeat<H, Is>..., ReadSink>;
+
+  static typename Type::Ptr create() {
+    return Type::create(Repeat<H, Is>()..., ReadSink());
+  }
+};
+
+template <template <class, class, class...> class P, class H, class Indices>
+struct WriteChain;
+
+// A WriteSink followed by n handlers.
+template <template <class, class, class...> class P, class H, size_t... Is>
+struct WriteChain<P, H, std::index_sequence<Is...>> {
+  using Type = P<Unit, int, WriteSink, Repeat<H, Is>...>;
+
+  static typename Type::Ptr create() {
+    return Type::create(WriteSink(), Repeat<H, Is>()...);
+  }
+};
+
+template <class H>
+Pipeline<int>::Ptr makeReadPipeline(size_t n) {
+  auto pipeline = Pipeline<int>::create();
+  for (size_t i = 0; i < n; ++i) {
+    pipeline->addBack(H());
+  }
+  pipeline->addBack(ReadSink()).finalize();
+  return pipeline;
+}
+
+template <class H>
+Pipeline<Unit, int>::Ptr makeWritePipeline(size_t n) {
+  auto pipeline = Pipeline<Unit, int>::create();
+  pipeline->addBack(WriteSink());
+  for (size_t i = 0; i < n; ++i) {
+    pipeline->addBack(H());
+  }
+  pipeline->finalize();
+  return pipeline;
+}
+
+template <class P>
+void readMessages(P& pipeline, size_t iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    pipeline.read(static_cast<int>(i));
+  }
+}
+
+template <class P>
+void writeMessages(P& pipeline, size_t iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(pipeline.write(static_cast<int>(i)));
+  }
+}
+
+template <class H>
+void pipelineRead(size_t iters, size_t n) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = makeReadPipeline<H>(n);
+  suspender.dismiss();
+  readMessages(*pipeline, iters);
+}
+
+template <template <class, class, class...> class P, class H, size_t N>
+void staticRead(size_t iters) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = ReadChain<P, H, std::make_index_sequence<N>>::create();
+  suspender.dismiss();
+  readMessages(*pipeline, iters);
+}
+
+template <class H>
+void pipelineWrite(size_t iters, size_t n) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = makeWritePipeline<H>(n);
+  suspender.dismiss();
+  writeMessages(*pipeline, iters);
+}
+
+template <template <class, class, class...> class P, class H, size_t N>
+void staticWrite(size_t iters) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = WriteChain<P, H, std::make_index_sequence<N>>::create();
+  suspender.dismiss();
+  writeMessages(*pipeline, iters);
+}
+
+// Includes destroying the pipeline again.
+void pipelineCreate(size_t iters, size_t n) {
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(makeReadPipeline<InboundPassThrough>(n));
+  }
+}
+
+template <size_t N>
+void staticCreate(size_t iters) {
+  using Chain = ReadChain<
+      StaticPipeline,
+      InboundPassThrough,
+      std::make_index_sequence<N>>;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(Chain::create());
+  }
+}
+
+void pipelineFinalize(size_t iters, size_t n) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = makeReadPipeline<InboundPassThrough>(n);
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    pipeline->finalize();
+  }
+}
+
+void pipelineAddBackRemove(size_t iters, size_t n) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = makeReadPipeline<InboundPassThrough>(n);
+  InboundPassThrough extra;
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    pipeline->addBack(&extra).finalize();
+    pipeline->remove(&extra).finalize();
+  }
+}
+
+void pipelineReadWithRequestContext(
+    size_t iters,
+    size_t n,
+    RequestContextPolicy policy = RequestContextPolicy::PER_CALL) {
+  folly::BenchmarkSuspender suspender;
+  auto pipeline = makeReadPipeline<InboundPassThrough>(n);
+  auto requestContext = std::make_shared<folly::RequestContext>();
+  pipeline->setRequestContext(requestContext);
+  pipeline->setRequestContextPolicy(policy);
+  // A connection-level context, current across all the reads.
+  folly::RequestContextScopeGuard guard(requestContext);
+  suspender.dismiss();
+  readMessages(*pipeline, iters);
+}
+
+} // namespace
+
+#define WANGLE_PIPELINE_BENCHMARKS(n)                                       \
+  BENCHMARK(Read_Pipeline_Inbound_##n, iters) {                             \
+    pipelineRead<InboundPassThrough>(iters, n);                             \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_Pipeline_Bidirectional_##n, iters) {              \
+    pipelineRead<ReadPassThrough>(iters, n);                                \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_Pipeline_RequestContext_##n, iters) {             \
+    pipelineReadWithRequestContext(iters, n);                               \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_Pipeline_RequestContextEntryPoint_##n, iters) {   \
+    pipelineReadWithRequestContext(                                         \
+        iters, n, RequestContextPolicy::ENTRY_POINT);                       \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_StaticPipeline_Inbound_##n, iters) {              \
+    staticRead<StaticPipeline, InboundPassThrough, n>(iters);               \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_StaticPipeline_Bidirectional_##n, iters) {        \
+    staticRead<StaticPipeline, ReadPassThrough, n>(iters);                  \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_LinkedStaticPipeline_Inbound_##n, iters) {        \
+    staticRead<LinkedStaticPipeline, InboundPassThrough, n>(iters);         \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Read_LinkedStaticPipeline_Bidirectional_##n, iters) {  \
+    staticRead<LinkedStaticPipeline, ReadPassThrough, n>(iters);            \
+  }                                                                         \
+  BENCHMARK_DRAW_LINE();                                                    \
+  BENCHMARK(Write_Pipeline_Outbound_##n, iters) {                           \
+    pipelineWrite<OutboundPassThrough>(iters, n);                           \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Write_Pipeline_Bidirectional_##n, iters) {             \
+    pipelineWrite<WritePassThrough>(iters, n);                              \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Write_StaticPipeline_Outbound_##n, iters) {            \
+    staticWrite<StaticPipeline, OutboundPassThrough, n>(iters);             \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Write_StaticPipeline_Bidirectional_##n, iters) {       \
+    staticWrite<StaticPipeline, WritePassThrough, n>(iters);                \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Write_LinkedStaticPipeline_Outbound_##n, iters) {      \
+    staticWrite<LinkedStaticPipeline, OutboundPassThrough, n>(iters);       \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Write_LinkedStaticPipeline_Bidirectional_##n, iters) { \
+    staticWrite<LinkedStaticPipeline, WritePassThrough, n>(iters);          \
+  }                                                                         \
+  BENCHMARK_DRAW_LINE();                                                    \
+  BENCHMARK(Create_Pipeline_##n, iters) {                                   \
+    pipelineCreate(iters, n);                                               \
+  }                                                                         \
+  BENCHMARK_RELATIVE(Create_StaticPipeline_##n, iters) {                    \
+    staticCreate<n>(iters);                                                 \
+  }                                                                         \
+  BENCHMARK(Finalize_Pipeline_##n, iters) {                                 \
+    pipelineFinalize(iters, n);                                             \
+  }                                                                         \
+  BENCHMARK(AddBackRemove_Pipeline_##n, iters) {                            \
+    pipelineAddBackRemove(iters, n);                                        \
+  }                                                                         \
+  BENCHMARK_DRAW_LINE();
+
+WANGLE_PIPELINE_BENCHMARKS(1)
+WANGLE_PIPELINE_BENCHMARKS(2)
+WANGLE_PIPELINE_BENCHMARKS(4)
+WANGLE_PIPELINE_BENCHMARKS(8)
+WANGLE_PIPELINE_BENCHMARKS(16)
+
+int main(int argc, char** argv) {
+  const folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
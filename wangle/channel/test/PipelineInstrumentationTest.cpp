@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <numeric>
+
+#include <folly/portability/GTest.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/channel/Pipeline.h>
+#include <wangle/channel/PipelineInstrumentation.h>
+
+using namespace folly;
+using namespace wangle;
+
+using Event = PipelineInstrumentation::Event;
+using Histogram = PipelineInstrumentation::Histogram;
+
+namespace {
+
+class RecordingStats : public PipelineInstrumentation::StatsCallback {
+ public:
+  void onHandlerStats(StringPiece handler, Event event, const Histogram& h)
+      override {
+    stats_[{handler.str(), event}] = h;
+  }
+
+  template <class H>
+  uint64_t count(Event event) const {
+    auto it = stats_.find({demangle(typeid(H)).toStdString(), event});
+    return it == stats_.end() ? 0 : it->second.count;
+  }
+
+  const std::map<std::pair<std::string, Event>, Histogram>& stats() const {
+    return stats_;
+  }
+
+ private:
+  std::map<std::pair<std::string, Event>, Histogram> stats_;
+};
+
+RecordingStats collectStats() {
+  RecordingStats stats;
+  PipelineInstrumentation::collect(stats);
+  return stats;
+}
+
+struct OuterHandler {};
+struct InnerHandler {};
+
+class PipelineInstrumentationTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    PipelineInstrumentation::reset();
+    detail::handlerSampleState().countdown = 0;
+  }
+
+  void TearDown() override {
+    PipelineInstrumentation::setSampleRate(0);
+  }
+};
+
+} // namespace
+
+TEST_F(PipelineInstrumentationTest, Disabled) {
+  {
+    detail::HandlerSample<OuterHandler, true> sample(Event::READ);
+  }
+  auto stats = collectStats();
+  EXPECT_EQ(0, stats.count<OuterHandler>(Event::READ));
+}
+
+TEST_F(PipelineInstrumentationTest, NestedSamples) {
+  PipelineInstrumentation::setSampleRate(1);
+  {
+    detail::HandlerSample<OuterHandler, true> outer(Event::READ);
+    {
+      detail::HandlerSample<InnerHandler, true> inner(Event::WRITE);
+    }
+  }
+  EXPECT_EQ(nullptr, detail::handlerSampleState().childTicks);
+
+  auto stats = collectStats();
+  EXPECT_EQ(1, stats.count<OuterHandler>(Event::READ));
+  EXPECT_EQ(0, stats.count<OuterHandler>(Event::WRITE));
+  EXPECT_EQ(1, stats.count<InnerHandler>(Event::WRITE));
+  for (const auto& entry : stats.stats()) {
+    const auto& histogram = entry.second;
+    EXPECT_EQ(
+        histogram.count,
+        std::accumulate(
+            histogram.buckets.begin(), histogram.buckets.end(), uint64_t(0)));
+    EXPECT_LE(histogram.maxTicks, histogram.totalTicks);
+  }
+
+  PipelineInstrumentation::reset();
+  EXPECT_TRUE(collectStats().stats().empty());
+}
+
+TEST_F(PipelineInstrumentationTest, SampleRate) {
+  PipelineInstrumentation::setSampleRate(0.25);
+  EXPECT_EQ(4, PipelineInstrumentation::getSamplePeriod());
+  for (int i = 0; i < 8; i++) {
+    detail::HandlerSample<OuterHandler, true> outer(Event::READ);
+    // Nested calls are timed with the message they belong to.
+    detail::HandlerSample<InnerHandler, true> inner(Event::READ);
+  }
+  auto stats = collectStats();
+  EXPECT_EQ(2, stats.count<OuterHandler>(Event::READ));
+  EXPECT_EQ(2, stats.count<InnerHandler>(Event::READ));
+}
+
+namespace {
+
+class PlusOneHandler : public HandlerAdapter<int> {
+ public:
+  void read(Context* ctx, int msg) override {
+    ctx->fireRead(msg + 1);
+  }
+};
+
+class SinkHandler : public HandlerAdapter<int> {
+ public:
+  void read(Context* /*ctx*/, int msg) override {
+    sum += msg;
+  }
+
+  int sum{0};
+};
+
+} // namespace
+
+TEST_F(PipelineInstrumentationTest, Pipeline) {
+  if (!WANGLE_PIPELINE_INSTRUMENTATION) {
+    GTEST_SKIP() << "built without WANGLE_PIPELINE_INSTRUMENTATION";
+  }
+  PlusOneHandler plusOne;
+  SinkHandler sink;
+  auto pipeline = Pipeline<int, int>::create();
+  pipeline->addBack(&plusOne).addBack(&sink).finalize();
+
+  PipelineInstrumentation::setSampleRate(0.5);
+  for (int i = 0; i < 10; i++) {
+    pipeline->read(0);
+  }
+  EXPECT_EQ(10, sink.sum);
+
+  auto stats = collectStats();
+  EXPECT_EQ(5, stats.count<PlusOneHandler>(Event::READ));
+  EXPECT_EQ(5, stats.count<SinkHandler>(Event::READ));
+}
@@ -20,6 +20,7 @@
 #include <folly/portability/GTest.h>
 #include <wangle/channel/AsyncSocketHandler.h>
 #include <wangle/channel/Handler.h>
+#include <wangle/channel/LinkedStaticPipeline.h>
 #include <wangle/channel/OutputBufferingHandler.h>
 #include <wangle/channel/Pipeline.h>
 #include <wangle/channel/StaticPipeline.h>
@@ -436,3 +437,174 @@ TEST(PipelineTest, HandlerReuse) {
   pipeline3->read(1);
   EXPECT_NE(nullptr, handler2.getContext());
 }
+
+namespace {
+
+class AddHandler : public HandlerAdapter<int> {
+ public:
+  explicit AddHandler(int n) : n_(n) {}
+
+  void read(Context* ctx, int msg) override {
+    ctx->fireRead(msg + n_);
+  }
+
+  Future<Unit> write(Context* ctx, int msg) override {
+    return ctx->fireWrite(msg + n_);
+  }
+
+ private:
+  int n_;
+};
+
+class DoubleOutboundHandler : public OutboundHandler<int> {
+ public:
+  Future<Unit> write(Context* ctx, int msg) override {
+    return ctx->fireWrite(msg * 2);
+  }
+};
+
+// Records the messages that reach it instead of passing them on.
+class RecordingHandler : public HandlerAdapter<int> {
+ public:
+  RecordingHandler(std::vector<int>* reads, std::vector<int>* writes)
+      : reads_(reads), writes_(writes) {}
+
+  void read(Context* ctx, int msg) override {
+    if (reads_) {
+      reads_->push_back(msg);
+    } else {
+      ctx->fireRead(msg);
+    }
+  }
+
+  Future<Unit> write(Context* ctx, int msg) override {
+    if (writes_) {
+      writes_->push_back(msg);
+      return makeFuture();
+    }
+    return ctx->fireWrite(msg);
+  }
+
+ private:
+  std::vector<int>* reads_;
+  std::vector<int>* writes_;
+};
+
+} // namespace
+
+TEST(PipelineTest, LinkedStaticPipeline) {
+  std::vector<int> reads, writes;
+  auto pipeline = LinkedStaticPipeline<
+      int,
+      int,
+      RecordingHandler,
+      AddHandler,
+      DoubleOutboundHandler,
+      AddHandler,
+      RecordingHandler>::
+      create(
+          RecordingHandler(nullptr, &writes),
+          AddHandler(1),
+          DoubleOutboundHandler(),
+          AddHandler(10),
+          RecordingHandler(&reads, nullptr));
+  EXPECT_EQ(5, pipeline->numHandlers());
+  EXPECT_TRUE(pipeline->getHandler<DoubleOutboundHandler>());
+
+  // Inbound skips the outbound-only handler and vice versa.
+  pipeline->read(1);
+  EXPECT_EQ(std::vector<int>{12}, reads);
+  pipeline->write(1);
+  EXPECT_EQ(std::vector<int>{23}, writes);
+}
+
+TEST(PipelineTest, CreateRecycled) {
+  using RecycledPipeline =
+      StaticPipeline<int, int, AddHandler, RecordingHandler>;
+  EventBase evb;
+  std::vector<int> reads;
+  auto pipeline = RecycledPipeline::createRecycled(
+      evb, AddHandler(1), RecordingHandler(&reads, nullptr));
+  pipeline->read(1);
+  EXPECT_EQ(std::vector<int>{2}, reads);
+  auto address = pipeline.get();
+  pipeline.reset();
+
+  // The block of the destroyed pipeline is reused by the next one.
+  pipeline = RecycledPipeline::createRecycled(
+      evb, AddHandler(2), RecordingHandler(&reads, nullptr));
+  EXPECT_EQ(address, pipeline.get());
+  EXPECT_EQ(2, pipeline->numHandlers());
+  pipeline->read(1);
+  EXPECT_EQ((std::vector<int>{2, 3}), reads);
+
+  auto recycler = PipelineRecycler::get<RecycledPipeline>(evb);
+  EXPECT_EQ(1, recycler->getStats().allocated);
+  EXPECT_EQ(1, recycler->getStats().reused);
+  EXPECT_EQ(1, recycler->getStats().recycled);
+}
+
+class RequestContextRecorder : public HandlerAdapter<int> {
+ public:
+  explicit RequestContextRecorder(std::vector<RequestContext*>* contexts)
+      : contexts_(contexts) {}
+
+  // Writes the message back through the pipeline under a context of its own.
+  void read(Context* ctx, int msg) override {
+    contexts_->push_back(RequestContext::try_get());
+    RequestContextScopeGuard guard(handlerContext_);
+    dynamic_cast<Pipeline<int, int>*>(ctx->getPipeline())->write(msg);
+  }
+
+  Future<Unit> write(Context* /*ctx*/, int /*msg*/) override {
+    contexts_->push_back(RequestContext::try_get());
+    return makeFuture();
+  }
+
+  const std::shared_ptr<RequestContext> handlerContext_{
+      std::make_shared<RequestContext>()};
+
+ private:
+  std::vector<RequestContext*>* contexts_;
+};
+
+TEST(PipelineTest, RequestContextPolicy) {
+  auto connContext = std::make_shared<RequestContext>();
+  std::vector<RequestContext*> contexts;
+  RequestContextRecorder handler(&contexts);
+  auto pipeline = Pipeline<int, int>::create();
+  pipeline->addBack(&handler).finalize();
+  pipeline->setRequestContext(connContext);
+
+  pipeline->read(1);
+  EXPECT_EQ(
+      (std::vector<RequestContext*>{connContext.get(), connContext.get()}),
+      contexts);
+  EXPECT_EQ(2, pipeline->getRequestContextStats().switches);
+  EXPECT_EQ(0, pipeline->getRequestContextStats().skipped);
+
+  // Re-entering the pipeline keeps the handler's context.
+  contexts.clear();
+  pipeline->setRequestContextPolicy(RequestContextPolicy::ENTRY_POINT);
+  pipeline->read(1);
+  EXPECT_EQ(
+      (std::vector<RequestContext*>{
+          connContext.get(), handler.handlerContext_.get()}),
+      contexts);
+  EXPECT_EQ(3, pipeline->getRequestContextStats().switches);
+  EXPECT_EQ(1, pipeline->getRequestContextStats().skipped);
+
+  // No switch if the context is current already.
+  contexts.clear();
+  {
+    RequestContextScopeGuard guard(connContext);
+    pipeline->read(1);
+  }
+  EXPECT_EQ(
+      (std::vector<RequestContext*>{
+          connContext.get(), handler.handlerContext_.get()}),
+      contexts);
+  EXPECT_EQ(3, pipeline->getRequestContextStats().switches);
+  EXPECT_EQ(3, pipeline->getRequestContextStats().skipped);
+  EXPECT_EQ(nullptr, detail::enteredPipeline());
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/portability/GTest.h>
+#include <wangle/channel/OutputBufferingHandler.h>
+#include <wangle/channel/StaticPipeline.h>
+#include <wangle/channel/WriteFlushScheduler.h>
+#include <wangle/channel/test/MockHandler.h>
+
+using namespace folly;
+using namespace testing;
+using namespace wangle;
+
+namespace {
+
+class CountingFlushable : public WriteFlushScheduler::Flushable {
+ public:
+  void flushWrites() noexcept override {
+    ++flushes;
+  }
+
+  int flushes{0};
+};
+
+} // namespace
+
+TEST(WriteFlushSchedulerTest, CoalescesPerLoop) {
+  EventBase evb;
+  auto& scheduler = WriteFlushScheduler::get(evb);
+  EXPECT_EQ(&scheduler, &WriteFlushScheduler::get(evb));
+
+  CountingFlushable a, b;
+  scheduler.schedule(a);
+  scheduler.schedule(a);
+  scheduler.schedule(b);
+  EXPECT_TRUE(a.isFlushScheduled());
+  evb.loopOnce();
+  EXPECT_EQ(1, a.flushes);
+  EXPECT_EQ(1, b.flushes);
+  EXPECT_FALSE(a.isFlushScheduled());
+
+  const auto& stats = scheduler.getStats();
+  EXPECT_EQ(3, stats.writesScheduled);
+  EXPECT_EQ(1, stats.flushPasses);
+  EXPECT_EQ(2, stats.pipelinesFlushed);
+  EXPECT_EQ(0, stats.pipelinesDeferred);
+}
+
+TEST(WriteFlushSchedulerTest, FlushBudget) {
+  EventBase evb;
+  auto& scheduler = WriteFlushScheduler::get(evb);
+  scheduler.setFlushBudget(2);
+
+  CountingFlushable flushables[3];
+  for (auto& flushable : flushables) {
+    scheduler.schedule(flushable);
+  }
+  evb.loopOnce();
+  EXPECT_EQ(1, flushables[0].flushes);
+  EXPECT_EQ(1, flushables[1].flushes);
+  EXPECT_EQ(0, flushables[2].flushes);
+  EXPECT_EQ(1, scheduler.getStats().pipelinesDeferred);
+
+  evb.loopOnce();
+  EXPECT_EQ(1, flushables[2].flushes);
+  EXPECT_EQ(2, scheduler.getStats().flushPasses);
+}
+
+TEST(WriteFlushSchedulerTest, CancelFlush) {
+  EventBase evb;
+  auto& scheduler = WriteFlushScheduler::get(evb);
+  CountingFlushable a, b;
+  scheduler.schedule(a);
+  scheduler.schedule(b);
+  a.cancelFlush();
+  {
+    // Destroying a scheduled flushable also dequeues it.
+    CountingFlushable c;
+    scheduler.schedule(c);
+  }
+  evb.loopOnce();
+  EXPECT_EQ(0, a.flushes);
+  EXPECT_EQ(1, b.flushes);
+}
+
+TEST(WriteFlushSchedulerTest, OutputBufferingHandler) {
+  using MockBytesHandler =
+      StrictMock<MockHandlerAdapter<IOBufQueue&, std::unique_ptr<IOBuf>>>;
+  using BufferingPipeline = StaticPipeline<
+      IOBufQueue&,
+      std::unique_ptr<IOBuf>,
+      MockBytesHandler,
+      OutputBufferingHandler>;
+
+  EventBase evb;
+  MockBytesHandler mockHandler1, mockHandler2;
+  EXPECT_CALL(mockHandler1, attachPipeline(_));
+  EXPECT_CALL(mockHandler2, attachPipeline(_));
+  OutputBufferingHandler buffering1, buffering2;
+  buffering1.setUseFlushScheduler(true);
+  buffering2.setUseFlushScheduler(true);
+  auto pipeline1 =
+      BufferingPipeline::create(&mockHandler1, std::move(buffering1));
+  auto pipeline2 =
+      BufferingPipeline::create(&mockHandler2, std::move(buffering2));
+  pipeline1->setTransport(AsyncSocket::newSocket(&evb));
+  pipeline2->setTransport(AsyncSocket::newSocket(&evb));
+
+  auto f1 = pipeline1->write(IOBuf::copyBuffer("hello"));
+  auto f2 = pipeline1->write(IOBuf::copyBuffer("world"));
+  auto f3 = pipeline2->write(IOBuf::copyBuffer("foo"));
+  EXPECT_FALSE(f1.isReady());
+  EXPECT_CALL(mockHandler1, write_(_, _));
+  EXPECT_CALL(mockHandler2, write_(_, _));
+  evb.loopOnce();
+  EXPECT_TRUE(f1.isReady());
+  EXPECT_TRUE(f2.isReady());
+  EXPECT_TRUE(f3.isReady());
+
+  const auto& stats = WriteFlushScheduler::get(evb).getStats();
+  EXPECT_EQ(3, stats.writesScheduled);
+  EXPECT_EQ(1, stats.flushPasses);
+  EXPECT_EQ(2, stats.pipelinesFlushed);
+
+  EXPECT_CALL(mockHandler1, detachPipeline(_));
+  EXPECT_CALL(mockHandler2, detachPipeline(_));
+  pipeline1.reset();
+  pipeline2.reset();
+}
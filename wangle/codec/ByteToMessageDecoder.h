@@ -39,6 +39,9 @@ namespace wangle {
  *
  * To check for complete frames without modify the reader index, use
  * IOBufQueue.front(), without split() or pop_front().
+ *
+ * With setMaxReadBatch(), the frames decoded from one read are passed on
+ * together with fireReadBatch() instead of one fireRead() each.
  */
 template <typename M>
 class ByteToMessageDecoder : public InboundHandler<folly::IOBufQueue&, M> {
@@ -48,6 +51,15 @@ class ByteToMessageDecoder : public InboundHandler<folly::IOBufQueue&, M> {
   /**
    * Decode bytes from buf into result.
    *
+   * If buf has insufficient bytes and the decoder knows how many more it
+   * needs, it should set needed to that count. read() then does not call
+   * decode() again until they have arrived. If this decoder reads the
+   * transport's queue, the pipeline's getReadBytesExpected() also lets the
+   * transport read them into one buffer. Only the decoder nearest the
+   * transport does that, the first one in the pipeline to be read: one
+   * behind it decodes bytes that have been read already, and leaves the
+   * pipeline's value alone.
+   *
    * @return bool - Return true if decoding is successful, false if buf
    *                has insufficient bytes.
    */
@@ -64,20 +76,110 @@ class ByteToMessageDecoder : public InboundHandler<folly::IOBufQueue&, M> {
     ctx->fireTransportInactive();
   }
 
+  void detachPipeline(Context* ctx) override {
+    auto pipeline = ctx->getPipeline();
+    if (pipeline->getReadBytesExpectedOwner() == this) {
+      pipeline->setReadBytesExpectedOwner(nullptr);
+      pipeline->setReadBytesExpected(0);
+    }
+  }
+
   void read(Context* ctx, folly::IOBufQueue& q) override {
+    auto pipeline = ctx->getPipeline();
+    if (!pipeline->getReadBytesExpectedOwner()) {
+      pipeline->setReadBytesExpectedOwner(this);
+    }
+    const bool fromTransport = pipeline->getReadBytesExpectedOwner() == this;
+    if (maxReadBatch_ > 1) {
+      readBatched(ctx, q, fromTransport);
+      return;
+    }
     bool success = true;
     while (success && transportActive_) {
       M result;
-      size_t needed = 0;
-      success = decode(ctx, q, result, needed);
+      success = decodeNext(ctx, q, result, fromTransport);
       if (success) {
         ctx->fireRead(std::move(result));
       }
     }
   }
 
+  /**
+   * Pass on up to maxFrames decoded frames at a time with fireReadBatch().
+   * 0 or 1, the default, fires every frame on its own. Note that whatever
+   * decode() fires itself, like a readException, overtakes the frames
+   * batched before it.
+   */
+  void setMaxReadBatch(size_t maxFrames) {
+    maxReadBatch_ = maxFrames;
+  }
+
  private:
+  // Only a decoder reading from the transport sets the pipeline's read
+  // bytes expected, which sizes the transport's reads.
+  bool decodeNext(
+      Context* ctx,
+      folly::IOBufQueue& q,
+      M& result,
+      bool fromTransport) {
+    if (decodeAt_ > 0) {
+      auto length = q.chainLength();
+      if (length < decodeAt_) {
+        if (fromTransport) {
+          ctx->getPipeline()->setReadBytesExpected(decodeAt_ - length);
+        }
+        return false;
+      }
+      decodeAt_ = 0;
+      if (fromTransport) {
+        ctx->getPipeline()->setReadBytesExpected(0);
+      }
+    }
+    size_t needed = 0;
+    if (decode(ctx, q, result, needed)) {
+      return true;
+    }
+    if (needed > 0) {
+      decodeAt_ = q.chainLength() + needed;
+      if (fromTransport) {
+        ctx->getPipeline()->setReadBytesExpected(needed);
+      }
+    }
+    return false;
+  }
+
+  void readBatched(Context* ctx, folly::IOBufQueue& q, bool fromTransport) {
+    // Taken for the duration of the read, so that the vector is reused
+    // across reads but a reentrant read gets its own.
+    auto batch = std::move(batch_);
+    bool success = true;
+    while (success && transportActive_) {
+      M result;
+      success = decodeNext(ctx, q, result, fromTransport);
+      if (success) {
+        batch.push_back(std::move(result));
+      }
+      if (batch.size() == maxReadBatch_ || (!success && !batch.empty())) {
+        fireBatch(ctx, batch);
+      }
+    }
+    batch_ = std::move(batch);
+  }
+
+  void fireBatch(Context* ctx, ReadBatch<M>& batch) {
+    if (batch.size() == 1) {
+      ctx->fireRead(std::move(batch.front()));
+    } else {
+      ctx->fireReadBatch(batch);
+    }
+    batch.clear();
+  }
+
   bool transportActive_ = true;
+  // Queue length to wait for before decoding again, 0 to always decode.
+  size_t decodeAt_{0};
+  size_t maxReadBatch_{0};
+  ReadBatch<M> batch_;
 };
 
 using ByteToByteDecoder = ByteToMessageDecoder<std::unique_ptr<folly::IOBuf>>;
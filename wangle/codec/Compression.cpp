@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/Compression.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <folly/compression/Compression.h>
+
+#if WANGLE_HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+using folly::IOBuf;
+
+namespace wangle {
+namespace detail {
+
+#if WANGLE_HAVE_LIBZSTD
+
+namespace {
+
+size_t check(size_t result) {
+  if (ZSTD_isError(result)) {
+    throw std::runtime_error(
+        std::string("zstd: ") + ZSTD_getErrorName(result));
+  }
+  return result;
+}
+
+} // namespace
+
+// The contexts and digested dictionaries are created on first use, as the
+// encoder only compresses and the decoder only uncompresses.
+struct ZstdDictionaryCodec::State {
+  ~State() {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDCtx(dctx);
+    ZSTD_freeDDict(ddict);
+  }
+
+  std::string dictionary;
+  int level;
+  ZSTD_CCtx* cctx{nullptr};
+  ZSTD_CDict* cdict{nullptr};
+  ZSTD_DCtx* dctx{nullptr};
+  ZSTD_DDict* ddict{nullptr};
+};
+
+ZstdDictionaryCodec::ZstdDictionaryCodec(
+    folly::StringPiece dictionary,
+    int level)
+    : state_(std::make_unique<State>()) {
+  state_->dictionary = dictionary.str();
+  // folly's named levels are negative, which zstd would take as its fast
+  // levels.
+  switch (level) {
+    case folly::io::COMPRESSION_LEVEL_FASTEST:
+      level = 1;
+      break;
+    case folly::io::COMPRESSION_LEVEL_DEFAULT:
+      level = ZSTD_CLEVEL_DEFAULT;
+      break;
+    case folly::io::COMPRESSION_LEVEL_BEST:
+      level = ZSTD_maxCLevel();
+      break;
+  }
+  state_->level = level;
+}
+
+ZstdDictionaryCodec::~ZstdDictionaryCodec() = default;
+
+std::unique_ptr<IOBuf> ZstdDictionaryCodec::compress(const IOBuf& data) {
+  auto& s = *state_;
+  if (!s.cctx) {
+    s.cctx = ZSTD_createCCtx();
+    s.cdict = ZSTD_createCDict(
+        s.dictionary.data(), s.dictionary.size(), s.level);
+    if (!s.cctx || !s.cdict) {
+      throw std::bad_alloc();
+    }
+    check(ZSTD_CCtx_refCDict(s.cctx, s.cdict));
+  }
+  check(ZSTD_CCtx_reset(s.cctx, ZSTD_reset_session_only));
+  auto length = data.computeChainDataLength();
+  check(ZSTD_CCtx_setPledgedSrcSize(s.cctx, length));
+
+  // The output has room for the worst case, so the frame is ended by a
+  // single call.
+  auto out = IOBuf::create(ZSTD_compressBound(length));
+  ZSTD_outBuffer output{out->writableTail(), out->tailroom(), 0};
+  for (auto range : data) {
+    ZSTD_inBuffer input{range.data(), range.size(), 0};
+    while (input.pos < input.size) {
+      check(ZSTD_compressStream2(s.cctx, &output, &input, ZSTD_e_continue));
+    }
+  }
+  ZSTD_inBuffer end{nullptr, 0, 0};
+  if (check(ZSTD_compressStream2(s.cctx, &output, &end, ZSTD_e_end)) != 0) {
+    throw std::runtime_error("zstd: frame not ended");
+  }
+  out->append(output.pos);
+  return out;
+}
+
+std::unique_ptr<IOBuf> ZstdDictionaryCodec::uncompress(
+    const IOBuf& data,
+    uint64_t uncompressedLength) {
+  auto& s = *state_;
+  if (!s.dctx) {
+    s.dctx = ZSTD_createDCtx();
+    s.ddict = ZSTD_createDDict(s.dictionary.data(), s.dictionary.size());
+    if (!s.dctx || !s.ddict) {
+      throw std::bad_alloc();
+    }
+    check(ZSTD_DCtx_refDDict(s.dctx, s.ddict));
+  }
+  check(ZSTD_DCtx_reset(s.dctx, ZSTD_reset_session_only));
+
+  auto out = IOBuf::create(uncompressedLength);
+  ZSTD_outBuffer output{out->writableTail(), uncompressedLength, 0};
+  size_t hint = 1;
+  for (auto range : data) {
+    ZSTD_inBuffer input{range.data(), range.size(), 0};
+    while (input.pos < input.size) {
+      if (hint == 0) {
+        throw std::runtime_error("zstd: data after the end of the frame");
+      }
+      auto consumed = input.pos;
+      auto produced = output.pos;
+      hint = check(ZSTD_decompressStream(s.dctx, &output, &input));
+      if (input.pos == consumed && output.pos == produced) {
+        throw std::runtime_error("zstd: frame longer than its length");
+      }
+    }
+  }
+  if (hint != 0 || output.pos != uncompressedLength) {
+    throw std::runtime_error("zstd: frame shorter than its length");
+  }
+  out->append(output.pos);
+  return out;
+}
+
+#else
+
+struct ZstdDictionaryCodec::State {};
+
+ZstdDictionaryCodec::ZstdDictionaryCodec(folly::StringPiece, int) {
+  throw std::runtime_error("zstd dictionaries need folly built with zstd");
+}
+
+ZstdDictionaryCodec::~ZstdDictionaryCodec() = default;
+
+std::unique_ptr<IOBuf> ZstdDictionaryCodec::compress(const IOBuf&) {
+  throw std::runtime_error("zstd dictionaries need folly built with zstd");
+}
+
+std::unique_ptr<IOBuf> ZstdDictionaryCodec::uncompress(
+    const IOBuf&,
+    uint64_t) {
+  throw std::runtime_error("zstd dictionaries need folly built with zstd");
+}
+
+#endif
+
+} // namespace detail
+} // namespace wangle
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <wangle/wangle-config.h>
+
+namespace wangle {
+
+/*
+ * Shared by CompressionEncoder and the decompression decoders.
+ *
+ * In PER_FRAME mode every message is compressed on its own, so that it can
+ * be framed (for example by LengthFieldPrepender) and decompressed on its
+ * own after LengthFieldBasedFrameDecoder. Each compressed message starts
+ * with a byte saying whether the rest is compressed; if it is, the length
+ * of the uncompressed message follows as a varint.
+ *
+ * In STREAMING mode the byte stream is compressed as a whole, after
+ * framing, which compresses better across small messages because each one
+ * can refer back to the previous ones. Every write is flushed.
+ */
+enum class CompressionMode : uint8_t {
+  PER_FRAME,
+  STREAMING,
+};
+
+namespace detail {
+
+// The first byte of a PER_FRAME message.
+constexpr uint8_t kUncompressedFrame = 0;
+constexpr uint8_t kCompressedFrame = 1;
+
+// Whether zstd dictionaries are available, which depends on wangle having
+// been built with zstd.
+#if WANGLE_HAVE_LIBZSTD
+constexpr bool kHaveZstdDictionaries = true;
+#else
+constexpr bool kHaveZstdDictionaries = false;
+#endif
+
+// Compresses single frames with a zstd dictionary, which folly::io::Codec
+// has no interface for. Only usable if kHaveZstdDictionaries.
+class ZstdDictionaryCodec {
+ public:
+  ZstdDictionaryCodec(folly::StringPiece dictionary, int level);
+  ~ZstdDictionaryCodec();
+
+  ZstdDictionaryCodec(const ZstdDictionaryCodec&) = delete;
+  ZstdDictionaryCodec& operator=(const ZstdDictionaryCodec&) = delete;
+
+  std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf& data);
+
+  // Throws if data is not a frame of uncompressedLength bytes.
+  std::unique_ptr<folly::IOBuf> uncompress(
+      const folly::IOBuf& data,
+      uint64_t uncompressedLength);
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+} // namespace detail
+
+} // namespace wangle
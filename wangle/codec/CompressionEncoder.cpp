@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/CompressionEncoder.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <folly/Varint.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/Time.h>
+#include <wangle/codec/LengthFieldPrepender.h>
+#include <wangle/util/Logging.h>
+
+using folly::Future;
+using folly::IOBuf;
+using folly::Unit;
+using folly::io::StreamCodec;
+
+namespace wangle {
+
+namespace {
+
+uint64_t threadCpuNs() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Writes header in front of buf, into its headroom if it can. A new IOBuf
+// leaves headroom for a LengthFieldPrepender to write into in turn.
+std::unique_ptr<IOBuf> prependHeader(
+    std::unique_ptr<IOBuf> buf,
+    folly::ByteRange header) {
+  if (!buf->isSharedOne() && buf->headroom() >= header.size()) {
+    buf->prepend(header.size());
+    std::memcpy(buf->writableData(), header.data(), header.size());
+    return buf;
+  }
+  auto out = IOBuf::copyBuffer(
+      header.data(), header.size(), LengthFieldPrepender::kHeadroom);
+  out->prependChain(std::move(buf));
+  return out;
+}
+
+} // namespace
+
+CompressionEncoder::CompressionEncoder(Options options)
+    : options_(std::move(options)), level_(options_.level) {
+  if (options_.mode == CompressionMode::PER_FRAME) {
+    WANGLE_CHECK(folly::io::hasCodec(options_.type));
+  } else {
+    WANGLE_CHECK(folly::io::hasStreamCodec(options_.type));
+  }
+  WANGLE_CHECK(
+      options_.dictionary.empty() ||
+      (options_.mode == CompressionMode::PER_FRAME &&
+       options_.type == folly::io::CodecType::ZSTD &&
+       detail::kHaveZstdDictionaries));
+  if (options_.cpuNsPerByte > 0) {
+    WANGLE_CHECK(options_.minLevel <= options_.maxLevel);
+    WANGLE_CHECK(level_ != folly::io::COMPRESSION_LEVEL_DEFAULT)
+        << "Adapting the compression level needs a level to start from";
+    if (level_ == folly::io::COMPRESSION_LEVEL_FASTEST) {
+      level_ = options_.minLevel;
+    } else if (level_ == folly::io::COMPRESSION_LEVEL_BEST) {
+      level_ = options_.maxLevel;
+    } else {
+      level_ = std::clamp(level_, options_.minLevel, options_.maxLevel);
+    }
+  }
+}
+
+Future<Unit> CompressionEncoder::write(
+    Context* ctx,
+    std::unique_ptr<IOBuf> buf) {
+  auto length = buf->computeChainDataLength();
+  if (options_.mode == CompressionMode::PER_FRAME &&
+      length < options_.minCompressLength) {
+    const uint8_t header = detail::kUncompressedFrame;
+    return ctx->fireWrite(
+        prependHeader(std::move(buf), folly::ByteRange(&header, 1)));
+  }
+
+  bool adaptive = options_.cpuNsPerByte > 0;
+  uint64_t start = adaptive ? threadCpuNs() : 0;
+  std::unique_ptr<IOBuf> out;
+  if (options_.mode == CompressionMode::PER_FRAME) {
+    out = compressFrame(std::move(buf), length);
+  } else {
+    out = compressStream(buf.get(), StreamCodec::FlushOp::FLUSH);
+  }
+
+  if (adaptive && adaptLevel(length, threadCpuNs() - start)) {
+    codec_.reset();
+    dictionaryCodec_.reset();
+    if (streamCodec_) {
+      // The decoder starts over with the stream that follows.
+      out->prependChain(
+          compressStream(nullptr, StreamCodec::FlushOp::END));
+      streamCodec_.reset();
+    }
+  }
+  return ctx->fireWrite(std::move(out));
+}
+
+std::unique_ptr<IOBuf> CompressionEncoder::compressFrame(
+    std::unique_ptr<IOBuf> buf,
+    uint64_t length) {
+  std::unique_ptr<IOBuf> compressed;
+  if (!options_.dictionary.empty()) {
+    if (!dictionaryCodec_) {
+      dictionaryCodec_ = std::make_unique<detail::ZstdDictionaryCodec>(
+          options_.dictionary, level_);
+    }
+    compressed = dictionaryCodec_->compress(*buf);
+  } else {
+    if (!codec_) {
+      codec_ = folly::io::getCodec(options_.type, level_);
+    }
+    compressed = codec_->compress(buf.get());
+  }
+
+  uint8_t header[1 + folly::kMaxVarintLength64];
+  if (compressed->computeChainDataLength() >= length) {
+    header[0] = detail::kUncompressedFrame;
+    return prependHeader(std::move(buf), folly::ByteRange(header, 1));
+  }
+  header[0] = detail::kCompressedFrame;
+  size_t headerLength = 1 + folly::encodeVarint(length, header + 1);
+  return prependHeader(
+      std::move(compressed), folly::ByteRange(header, headerLength));
+}
+
+std::unique_ptr<IOBuf> CompressionEncoder::compressStream(
+    const IOBuf* buf,
+    StreamCodec::FlushOp flushOp) {
+  if (!streamCodec_) {
+    streamCodec_ = folly::io::getStreamCodec(options_.type, level_);
+    streamCodec_->resetStream();
+  }
+
+  folly::IOBufQueue out;
+  auto run = [&](folly::ByteRange input, StreamCodec::FlushOp op) {
+    while (true) {
+      auto space = out.preallocate(4096, 16384);
+      folly::MutableByteRange output(
+          static_cast<uint8_t*>(space.first), space.second);
+      bool done = streamCodec_->compressStream(input, output, op);
+      out.postallocate(space.second - output.size());
+      if (op == StreamCodec::FlushOp::NONE ? input.empty() : done) {
+        return;
+      }
+    }
+  };
+  if (buf) {
+    for (auto range : *buf) {
+      if (!range.empty()) {
+        run(range, StreamCodec::FlushOp::NONE);
+      }
+    }
+  }
+  run(folly::ByteRange(), flushOp);
+
+  auto result = out.move();
+  return result ? std::move(result) : IOBuf::create(0);
+}
+
+bool CompressionEncoder::adaptLevel(uint64_t bytes, uint64_t cpuNs) {
+  windowBytes_ += bytes;
+  windowCpuNs_ += cpuNs;
+  if (windowBytes_ < kAdaptWindowBytes) {
+    return false;
+  }
+  double nsPerByte = double(windowCpuNs_) / windowBytes_;
+  windowBytes_ = 0;
+  windowCpuNs_ = 0;
+
+  // Only go up when well under budget, as the next level costs more, so
+  // that the level doesn't flap between two.
+  int level = level_;
+  if (nsPerByte > options_.cpuNsPerByte) {
+    level = std::max(level - 1, options_.minLevel);
+  } else if (nsPerByte < options_.cpuNsPerByte * 0.75) {
+    level = std::min(level + 1, options_.maxLevel);
+  }
+  if (level == level_) {
+    return false;
+  }
+  level_ = level;
+  return true;
+}
+
+} // namespace wangle
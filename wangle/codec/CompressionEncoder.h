@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <folly/compression/Compression.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/codec/Compression.h>
+
+namespace wangle {
+
+/**
+ * An encoder that compresses outbound messages with a folly::io::Codec, or
+ * the outbound byte stream with a folly::io::StreamCodec; see
+ * CompressionMode.
+ *
+ * In PER_FRAME mode it goes before the framing encoder, so that each frame
+ * carries one compressed message:
+ *
+ *   pipeline->addBack(LengthFieldBasedFrameDecoder())
+ *       .addBack(LengthFieldPrepender())
+ *       .addBack(DecompressionDecoder())
+ *       .addBack(CompressionEncoder())
+ *
+ * In STREAMING mode it goes after it, next to the transport, with a
+ * StreamDecompressionDecoder.
+ *
+ * @see DecompressionDecoder
+ * @see StreamDecompressionDecoder
+ */
+class CompressionEncoder : public OutboundBytesToBytesHandler {
+ public:
+  struct Options {
+    folly::io::CodecType type{folly::io::CodecType::ZSTD};
+    CompressionMode mode{CompressionMode::PER_FRAME};
+    int level{folly::io::COMPRESSION_LEVEL_DEFAULT};
+
+    // PER_FRAME only: messages shorter than this are sent uncompressed, as
+    // compressing them costs more than it saves. Messages that don't get
+    // smaller are sent uncompressed too.
+    size_t minCompressLength{0};
+
+    // PER_FRAME and ZSTD only: a dictionary trained on typical messages
+    // (zstd --train), which the decoder needs as well. It makes small
+    // messages compress almost as well as a stream does.
+    std::string dictionary;
+
+    // If not 0, the level is adapted within [minLevel, maxLevel] so that
+    // compressing takes about this much CPU time per input byte, measured
+    // over every MiB of input. The levels have to be valid for type.
+    // Adapting starts from level, clamped to the range, so level can't be
+    // COMPRESSION_LEVEL_DEFAULT; COMPRESSION_LEVEL_FASTEST and
+    // COMPRESSION_LEVEL_BEST start from minLevel and maxLevel.
+    double cpuNsPerByte{0};
+    int minLevel{1};
+    int maxLevel{9};
+  };
+
+  explicit CompressionEncoder(Options options = Options());
+
+  folly::Future<folly::Unit> write(
+      Context* ctx,
+      std::unique_ptr<folly::IOBuf> buf) override;
+
+  // The level compressing currently uses.
+  int getLevel() const {
+    return level_;
+  }
+
+ private:
+  static constexpr uint64_t kAdaptWindowBytes = 1024 * 1024;
+
+  std::unique_ptr<folly::IOBuf> compressFrame(
+      std::unique_ptr<folly::IOBuf> buf,
+      uint64_t length);
+  std::unique_ptr<folly::IOBuf> compressStream(
+      const folly::IOBuf* buf,
+      folly::io::StreamCodec::FlushOp flushOp);
+
+  // Accounts for compressing bytes in cpuNs, returns whether the level
+  // changed.
+  bool adaptLevel(uint64_t bytes, uint64_t cpuNs);
+
+  Options options_;
+  int level_;
+
+  // Created at the current level when first needed.
+  std::unique_ptr<folly::io::Codec> codec_;
+  std::unique_ptr<detail::ZstdDictionaryCodec> dictionaryCodec_;
+  std::unique_ptr<folly::io::StreamCodec> streamCodec_;
+
+  uint64_t windowBytes_{0};
+  uint64_t windowCpuNs_{0};
+};
+
+} // namespace wangle
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/Crc32cDecoder.h>
+
+#include <algorithm>
+
+#include <folly/hash/Checksum.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace wangle {
+
+void Crc32cDecoder::read(Context* ctx, std::unique_ptr<IOBuf> frame) {
+  constexpr size_t kTrailerLength = sizeof(uint32_t);
+  size_t length = frame->computeChainDataLength();
+  if (length < kTrailerLength) {
+    ctx->fireReadException(
+        folly::make_exception_wrapper<std::runtime_error>(
+            "Frame too short for a CRC32C"));
+    return;
+  }
+
+  // Checksum the IOBufs in place up to the trailer.
+  size_t remaining = length - kTrailerLength;
+  uint32_t crc = ~0U;
+  for (auto range : *frame) {
+    size_t n = std::min(range.size(), remaining);
+    crc = folly::crc32c(range.data(), n, crc);
+    remaining -= n;
+    if (remaining == 0) {
+      break;
+    }
+  }
+
+  folly::io::Cursor c(frame.get());
+  c.skip(length - kTrailerLength);
+  if (c.readBE<uint32_t>() != crc) {
+    ctx->fireReadException(
+        folly::make_exception_wrapper<std::runtime_error>("CRC32C mismatch"));
+    return;
+  }
+
+  IOBufQueue q;
+  q.append(std::move(frame));
+  q.trimEnd(kTrailerLength);
+  auto msg = q.move();
+  ctx->fireRead(msg ? std::move(msg) : IOBuf::create(0));
+}
+
+} // namespace wangle
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <wangle/channel/Handler.h>
+
+namespace wangle {
+
+/**
+ * Verifies and strips the CRC32C trailer Crc32cEncoder appends to each
+ * message. It goes after the frame decoder. A frame whose checksum doesn't
+ * match fires readException and is dropped, so corrupt data never reaches
+ * the handlers after it.
+ *
+ * @see Crc32cEncoder
+ */
+class Crc32cDecoder : public InboundHandler<
+                          std::unique_ptr<folly::IOBuf>,
+                          std::unique_ptr<folly::IOBuf>> {
+ public:
+  void read(Context* ctx, std::unique_ptr<folly::IOBuf> frame) override;
+};
+
+} // namespace wangle
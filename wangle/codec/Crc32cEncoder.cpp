@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/Crc32cEncoder.h>
+
+#include <cstring>
+
+#include <folly/hash/Checksum.h>
+#include <folly/lang/Bits.h>
+
+using folly::Future;
+using folly::IOBuf;
+using folly::Unit;
+
+namespace wangle {
+
+Future<Unit> Crc32cEncoder::write(Context* ctx, std::unique_ptr<IOBuf> buf) {
+  uint32_t crc = ~0U;
+  for (auto range : *buf) {
+    crc = folly::crc32c(range.data(), range.size(), crc);
+  }
+  crc = folly::Endian::big(crc);
+
+  IOBuf* last = buf->prev();
+  if (!last->isSharedOne() && last->tailroom() >= sizeof(crc)) {
+    std::memcpy(last->writableTail(), &crc, sizeof(crc));
+    last->append(sizeof(crc));
+  } else {
+    buf->prependChain(IOBuf::copyBuffer(&crc, sizeof(crc)));
+  }
+  return ctx->fireWrite(std::move(buf));
+}
+
+} // namespace wangle
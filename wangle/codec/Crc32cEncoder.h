@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <wangle/channel/Handler.h>
+
+namespace wangle {
+
+/**
+ * An encoder that appends the CRC32C of each outbound message to it, as 4
+ * big endian bytes, for Crc32cDecoder to verify. It goes before the framing
+ * encoder, so that the checksum is part of the frame:
+ *
+ *   pipeline->addBack(LengthFieldBasedFrameDecoder())
+ *       .addBack(LengthFieldPrepender())
+ *       .addBack(Crc32cDecoder())
+ *       .addBack(Crc32cEncoder())
+ *
+ * The checksum is computed with folly::crc32c(), which uses the SSE4.2
+ * instruction where available, over each IOBuf of the chain in turn. It is
+ * written into the tailroom of the last IOBuf when that is not shared and
+ * has room, and into a new IOBuf otherwise.
+ *
+ * @see Crc32cDecoder
+ */
+class Crc32cEncoder : public OutboundBytesToBytesHandler {
+ public:
+  folly::Future<folly::Unit> write(
+      Context* ctx,
+      std::unique_ptr<folly::IOBuf> buf) override;
+};
+
+} // namespace wangle
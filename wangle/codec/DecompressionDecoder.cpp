@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/DecompressionDecoder.h>
+
+#include <stdexcept>
+
+#include <folly/Varint.h>
+#include <folly/io/Cursor.h>
+#include <wangle/util/Logging.h>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace wangle {
+
+namespace {
+
+// The header is read a byte at a time as it can span IOBufs.
+uint64_t readVarint(folly::io::Cursor& c) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < folly::kMaxVarintLength64; i++) {
+    auto byte = c.read<uint8_t>();
+    value |= uint64_t(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("Uncompressed length longer than 10 bytes");
+}
+
+} // namespace
+
+DecompressionDecoder::DecompressionDecoder(Options options)
+    : options_(std::move(options)) {
+  WANGLE_CHECK(
+      options_.dictionary.empty() ||
+      (options_.type == folly::io::CodecType::ZSTD &&
+       detail::kHaveZstdDictionaries));
+  if (options_.dictionary.empty()) {
+    codec_ = folly::io::getCodec(options_.type);
+  } else {
+    dictionaryCodec_ = std::make_unique<detail::ZstdDictionaryCodec>(
+        options_.dictionary, folly::io::COMPRESSION_LEVEL_DEFAULT);
+  }
+}
+
+void DecompressionDecoder::read(Context* ctx, std::unique_ptr<IOBuf> frame) {
+  std::unique_ptr<IOBuf> msg;
+  try {
+    msg = uncompress(std::move(frame));
+  } catch (const std::exception&) {
+    ctx->fireReadException(folly::exception_wrapper(std::current_exception()));
+    return;
+  }
+  ctx->fireRead(std::move(msg));
+}
+
+std::unique_ptr<IOBuf> DecompressionDecoder::uncompress(
+    std::unique_ptr<IOBuf> frame) {
+  folly::io::Cursor c(frame.get());
+  auto type = c.read<uint8_t>();
+  uint64_t length = 0;
+  if (type == detail::kCompressedFrame) {
+    length = readVarint(c);
+    if (length > options_.maxUncompressedLength) {
+      throw std::runtime_error(
+          "Uncompressed frame larger than " +
+          folly::to<std::string>(options_.maxUncompressedLength));
+    }
+  } else if (type != detail::kUncompressedFrame) {
+    throw std::runtime_error(
+        "Unknown frame type " + folly::to<std::string>(type));
+  }
+
+  IOBufQueue q;
+  q.append(std::move(frame));
+  q.trimStart(c.getCurrentPosition());
+  auto data = q.move();
+  if (!data) {
+    data = IOBuf::create(0);
+  }
+  if (type == detail::kUncompressedFrame) {
+    return data;
+  }
+  if (dictionaryCodec_) {
+    return dictionaryCodec_->uncompress(*data, length);
+  }
+  return codec_->uncompress(data.get(), length);
+}
+
+StreamDecompressionDecoder::StreamDecompressionDecoder(
+    folly::io::CodecType type,
+    uint64_t maxBufferedOutput)
+    : codec_(folly::io::getStreamCodec(type)),
+      maxBufferedOutput_(maxBufferedOutput) {
+  WANGLE_CHECK_GT(maxBufferedOutput_, 0);
+  codec_->resetStream();
+}
+
+void StreamDecompressionDecoder::read(Context* ctx, IOBufQueue& q) {
+  if (failed_) {
+    q.move();
+    return;
+  }
+  while (!q.empty()) {
+    auto head = q.pop_front();
+    if (!uncompress(ctx, folly::ByteRange(head->data(), head->length()))) {
+      q.move();
+      return;
+    }
+  }
+  if (!output_.empty()) {
+    ctx->fireRead(output_);
+  }
+}
+
+bool StreamDecompressionDecoder::uncompress(
+    Context* ctx,
+    folly::ByteRange input) {
+  while (true) {
+    if (output_.chainLength() >= maxBufferedOutput_) {
+      ctx->fireRead(output_);
+      if (output_.chainLength() >= maxBufferedOutput_) {
+        fail(
+            ctx,
+            folly::make_exception_wrapper<std::runtime_error>(
+                "Decompressed data exceeds maxBufferedOutput"));
+        return false;
+      }
+    }
+    auto space = output_.preallocate(4096, 65536);
+    folly::MutableByteRange output(
+        static_cast<uint8_t*>(space.first), space.second);
+    bool ended;
+    try {
+      ended = codec_->uncompressStream(input, output);
+    } catch (const std::exception&) {
+      fail(ctx, folly::exception_wrapper(std::current_exception()));
+      return false;
+    }
+    output_.postallocate(space.second - output.size());
+    if (ended) {
+      // A new stream follows, for example after the encoder changed level.
+      codec_->resetStream();
+    }
+    // Done once all input is consumed, unless output filling up left some
+    // of it inside the codec.
+    if (input.empty() && (ended || !output.empty())) {
+      return true;
+    }
+  }
+}
+
+void StreamDecompressionDecoder::fail(
+    Context* ctx,
+    folly::exception_wrapper ew) {
+  failed_ = true;
+  output_.move();
+  ctx->fireReadException(std::move(ew));
+}
+
+} // namespace wangle
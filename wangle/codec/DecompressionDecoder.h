@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <folly/compression/Compression.h>
+#include <folly/io/IOBufQueue.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/codec/Compression.h>
+
+namespace wangle {
+
+/**
+ * Decompresses the frames a CompressionEncoder in PER_FRAME mode wrote. It
+ * goes after the frame decoder. Frames that fail to decompress fire
+ * readException and are dropped.
+ *
+ * The type and dictionary have to match the encoder's; the level doesn't
+ * matter. maxUncompressedLength bounds the memory a frame can expand to.
+ */
+class DecompressionDecoder : public InboundHandler<
+                                 std::unique_ptr<folly::IOBuf>,
+                                 std::unique_ptr<folly::IOBuf>> {
+ public:
+  struct Options {
+    folly::io::CodecType type{folly::io::CodecType::ZSTD};
+    std::string dictionary;
+    uint64_t maxUncompressedLength{UINT32_MAX};
+  };
+
+  explicit DecompressionDecoder(Options options = Options());
+
+  void read(Context* ctx, std::unique_ptr<folly::IOBuf> frame) override;
+
+ private:
+  std::unique_ptr<folly::IOBuf> uncompress(
+      std::unique_ptr<folly::IOBuf> frame);
+
+  Options options_;
+  std::unique_ptr<folly::io::Codec> codec_;
+  std::unique_ptr<detail::ZstdDictionaryCodec> dictionaryCodec_;
+};
+
+/**
+ * Decompresses the byte stream a CompressionEncoder in STREAMING mode
+ * wrote. It goes before the frame decoder, next to the transport.
+ *
+ * Once decompressing fails the rest of the stream can't be decompressed;
+ * readException is fired and everything received after is dropped.
+ *
+ * maxBufferedOutput bounds the memory a read can expand to. Once that much
+ * is decompressed it is passed on before going on, and if the next handler
+ * leaves that much unconsumed, for example as it's part of a frame longer
+ * than maxBufferedOutput, the stream fails.
+ */
+class StreamDecompressionDecoder
+    : public InboundHandler<folly::IOBufQueue&, folly::IOBufQueue&> {
+ public:
+  explicit StreamDecompressionDecoder(
+      folly::io::CodecType type = folly::io::CodecType::ZSTD,
+      uint64_t maxBufferedOutput = 64 * 1024 * 1024);
+
+  void read(Context* ctx, folly::IOBufQueue& q) override;
+
+ private:
+  // Returns false if the stream failed.
+  bool uncompress(Context* ctx, folly::ByteRange input);
+  void fail(Context* ctx, folly::exception_wrapper ew);
+
+  std::unique_ptr<folly::io::StreamCodec> codec_;
+  uint64_t maxBufferedOutput_;
+  folly::IOBufQueue output_{folly::IOBufQueue::cacheChainLength()};
+  bool failed_{false};
+};
+
+} // namespace wangle
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/DelimiterBasedFrameDecoder.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <wangle/util/Logging.h>
+
+namespace wangle {
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+DelimiterBasedFrameDecoder::DelimiterBasedFrameDecoder(
+    std::vector<std::string> delimiters,
+    uint32_t maxFrameLength,
+    bool stripDelimiter)
+    : delimiters_(std::move(delimiters)),
+      maxFrameLength_(maxFrameLength),
+      stripDelimiter_(stripDelimiter) {
+  WANGLE_CHECK(!delimiters_.empty());
+  for (const auto& delimiter : delimiters_) {
+    WANGLE_CHECK(!delimiter.empty());
+    auto first = static_cast<uint8_t>(delimiter[0]);
+    if (!isFirstByte_[first]) {
+      isFirstByte_[first] = true;
+      firstBytes_.push_back(delimiter[0]);
+    }
+  }
+}
+
+bool DelimiterBasedFrameDecoder::decode(
+    Context* ctx,
+    IOBufQueue& buf,
+    std::unique_ptr<IOBuf>& result,
+    size_t&) {
+  while (true) {
+    if (discarding_ && !discardFrame(buf)) {
+      return false;
+    }
+
+    auto delimiter = findDelimiter(buf, uint64_t(maxFrameLength_) + 1);
+    if (delimiter.partial) {
+      return false;
+    }
+    if (delimiter.offset >= 0) {
+      scanned_ = 0;
+      if (stripDelimiter_) {
+        result = buf.split(delimiter.offset);
+        buf.trimStart(delimiter.length);
+      } else {
+        result = buf.split(delimiter.offset + delimiter.length);
+      }
+      return true;
+    }
+
+    auto len = buf.chainLength();
+    if (len <= maxFrameLength_) {
+      return false;
+    }
+    // The first maxFrameLength_ + 1 bytes were searched already, the
+    // delimiter ending this frame can only come after them.
+    discarding_ = true;
+    fail(ctx, len);
+  }
+}
+
+bool DelimiterBasedFrameDecoder::discardFrame(IOBufQueue& buf) {
+  auto delimiter = findDelimiter(buf, std::numeric_limits<uint64_t>::max());
+  scanned_ = 0;
+  if (delimiter.offset >= 0 && !delimiter.partial) {
+    buf.trimStart(delimiter.offset + delimiter.length);
+    discarding_ = false;
+    return true;
+  }
+  // Keep what may be the start of the delimiter.
+  buf.trimStart(delimiter.partial ? delimiter.offset : buf.chainLength());
+  return false;
+}
+
+void DelimiterBasedFrameDecoder::fail(Context* ctx, uint64_t length) {
+  ctx->fireReadException(
+      folly::make_exception_wrapper<std::runtime_error>(
+          "frame length over " + folly::to<std::string>(length) +
+          " exceeds max " + folly::to<std::string>(maxFrameLength_)));
+}
+
+DelimiterBasedFrameDecoder::Delimiter DelimiterBasedFrameDecoder::findDelimiter(
+    const IOBufQueue& buf,
+    uint64_t limit) {
+  Delimiter delimiter;
+  const IOBuf* head = buf.front();
+  if (!head) {
+    return delimiter;
+  }
+
+  const IOBuf* segment = head;
+  uint64_t offset = 0;
+  do {
+    const uint64_t segmentEnd = offset + segment->length();
+    const uint64_t end = std::min(segmentEnd, limit);
+    if (scanned_ < end) {
+      const uint8_t* data = segment->data();
+      const size_t endIndex = end - offset;
+      std::array<size_t, kMaxMemchrBytes> next;
+      next.fill(kUnknown);
+      size_t index = std::max(offset, scanned_) - offset;
+      while ((index = nextCandidate(data, index, endIndex, next)) <
+             endIndex) {
+        auto match = matchAt(head, segment, index, delimiter.length);
+        if (match != MatchResult::NONE) {
+          delimiter.offset = offset + index;
+          delimiter.partial = match == MatchResult::PARTIAL;
+          scanned_ = delimiter.offset;
+          return delimiter;
+        }
+        index++;
+      }
+      scanned_ = end;
+    }
+    if (segmentEnd >= limit) {
+      break;
+    }
+    offset = segmentEnd;
+    segment = segment->next();
+  } while (segment != head);
+
+  return delimiter;
+}
+
+size_t DelimiterBasedFrameDecoder::nextCandidate(
+    const uint8_t* data,
+    size_t begin,
+    size_t end,
+    std::array<size_t, kMaxMemchrBytes>& next) const {
+  if (firstBytes_.size() > kMaxMemchrBytes) {
+    while (begin < end && !isFirstByte_[data[begin]]) {
+      begin++;
+    }
+    return begin;
+  }
+
+  // next[i] is where firstBytes_[i] occurs next, or end if it doesn't. It is
+  // only searched again once begin has passed it, so each byte of the
+  // segment is looked at once per first byte.
+  size_t candidate = end;
+  for (size_t i = 0; i < firstBytes_.size(); i++) {
+    if (next[i] == kUnknown || next[i] < begin) {
+      auto found = static_cast<const uint8_t*>(
+          memchr(data + begin, firstBytes_[i], end - begin));
+      next[i] = found ? found - data : end;
+    }
+    candidate = std::min(candidate, next[i]);
+  }
+  return candidate;
+}
+
+DelimiterBasedFrameDecoder::MatchResult DelimiterBasedFrameDecoder::matchAt(
+    const IOBuf* head,
+    const IOBuf* segment,
+    size_t index,
+    size_t& length) const {
+  for (const auto& delimiter : delimiters_) {
+    const IOBuf* current = segment;
+    size_t i = index;
+    size_t matched = 0;
+    if (i + delimiter.size() <= current->length()) {
+      matched = memcmp(current->data() + i, delimiter.data(), delimiter.size())
+          ? 0
+          : delimiter.size();
+    } else {
+      // The delimiter would continue into the next IOBufs.
+      for (; matched < delimiter.size(); matched++, i++) {
+        while (i == current->length()) {
+          current = current->next();
+          i = 0;
+          if (current == head) {
+            // The queue ends within the delimiter. Whether a delimiter given
+            // before another one matches decides which frame is shortest.
+            return MatchResult::PARTIAL;
+          }
+        }
+        if (current->data()[i] != static_cast<uint8_t>(delimiter[matched])) {
+          break;
+        }
+      }
+    }
+    if (matched == delimiter.size()) {
+      length = delimiter.size();
+      return MatchResult::FULL;
+    }
+  }
+  return MatchResult::NONE;
+}
+
+} // namespace wangle
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <wangle/codec/ByteToMessageDecoder.h>
+
+namespace wangle {
+
+/**
+ * A decoder that splits the received IOBufQueue on one or more delimiters,
+ * for example "\r\n\r\n" or "\0".
+ *
+ * If several delimiters are found, the one that makes the shortest frame
+ * wins, and of those that start at the same byte the first one given.
+ * For example, with the delimiters "\r\n" and "\n",
+ *
+ * +--------------+
+ * | ABC\nDEF\r\n |
+ * +--------------+
+ *
+ * is decoded into
+ *
+ * +-----+-----+
+ * | ABC | DEF |
+ * +-----+-----+
+ *
+ * If no delimiter is found within maxFrameLength bytes, readException is
+ * fired and everything up to and including the next delimiter is discarded.
+ *
+ * Delimiters are found by searching each IOBuf in the chain for their first
+ * bytes with memchr(), so the chain is never coalesced, and the decoder
+ * remembers how far it has searched between reads.
+ */
+class DelimiterBasedFrameDecoder : public ByteToByteDecoder {
+ public:
+  explicit DelimiterBasedFrameDecoder(
+      std::vector<std::string> delimiters,
+      uint32_t maxFrameLength = UINT_MAX,
+      bool stripDelimiter = true);
+
+  bool decode(
+      Context* ctx,
+      folly::IOBufQueue& buf,
+      std::unique_ptr<folly::IOBuf>& result,
+      size_t&) override;
+
+ private:
+  // More distinct first bytes than this are looked up in a table instead.
+  static constexpr size_t kMaxMemchrBytes = 4;
+  static constexpr size_t kUnknown = SIZE_MAX;
+
+  enum class MatchResult { NONE, PARTIAL, FULL };
+
+  struct Delimiter {
+    // Offset of the delimiter in the queue, -1 if none was found.
+    int64_t offset{-1};
+    size_t length{0};
+    // Whether the queue ends within the delimiter, so that it is not known
+    // yet whether it is one.
+    bool partial{false};
+  };
+
+  // Looks for the first delimiter starting before limit.
+  Delimiter findDelimiter(const folly::IOBufQueue& buf, uint64_t limit);
+
+  // Finds the next byte that starts a delimiter in [begin, end) of data.
+  size_t nextCandidate(
+      const uint8_t* data,
+      size_t begin,
+      size_t end,
+      std::array<size_t, kMaxMemchrBytes>& next) const;
+
+  MatchResult matchAt(
+      const folly::IOBuf* head,
+      const folly::IOBuf* segment,
+      size_t index,
+      size_t& length) const;
+
+  // Discards the rest of a frame that is too long. Returns true once the
+  // delimiter ending it has been discarded too.
+  bool discardFrame(folly::IOBufQueue& buf);
+
+  void fail(Context* ctx, uint64_t length);
+
+  std::vector<std::string> delimiters_;
+  // The distinct first bytes of the delimiters.
+  std::string firstBytes_;
+  std::array<bool, 256> isFirstByte_{};
+
+  uint32_t maxFrameLength_;
+  bool stripDelimiter_;
+
+  bool discarding_{false};
+  // Bytes at the front of the queue known not to start a delimiter.
+  uint64_t scanned_{0};
+};
+
+} // namespace wangle
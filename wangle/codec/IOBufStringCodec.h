@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <folly/io/Cursor.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/util/Logging.h>
+
+namespace wangle {
+
+/*
+ * A message that refers to the bytes of an inbound IOBuf chain instead of
+ * copying them into a std::string. It is move-only, and owns the chain.
+ *
+ * A frame that arrived in one IOBuf can be looked at in place through
+ * view(). A chained one can be read with cursor(), or made contiguous with
+ * coalesce(), which copies only in that case.
+ */
+class IOBufString {
+ public:
+  explicit IOBufString(std::unique_ptr<folly::IOBuf> buf)
+      : buf_(buf ? std::move(buf) : folly::IOBuf::create(0)) {}
+
+  IOBufString(IOBufString&&) = default;
+  IOBufString& operator=(IOBufString&&) = default;
+  IOBufString(const IOBufString&) = delete;
+  IOBufString& operator=(const IOBufString&) = delete;
+
+  bool empty() const {
+    return buf_->empty();
+  }
+
+  // Walks the chain.
+  size_t size() const {
+    return buf_->computeChainDataLength();
+  }
+
+  bool isContiguous() const {
+    return !buf_->isChained();
+  }
+
+  // Only valid if isContiguous(), and while this message is alive.
+  std::string_view view() const {
+    WANGLE_DCHECK(isContiguous());
+    return std::string_view(
+        reinterpret_cast<const char*>(buf_->data()), buf_->length());
+  }
+
+  // Makes the bytes contiguous if they are not, and views them.
+  std::string_view coalesce() {
+    buf_->coalesce();
+    return view();
+  }
+
+  folly::io::Cursor cursor() const {
+    return folly::io::Cursor(buf_.get());
+  }
+
+  // Copies the bytes.
+  std::string toString() const {
+    std::string str;
+    str.reserve(size());
+    for (auto range : *buf_) {
+      str.append(reinterpret_cast<const char*>(range.data()), range.size());
+    }
+    return str;
+  }
+
+  const folly::IOBuf& buf() const {
+    return *buf_;
+  }
+
+  std::unique_ptr<folly::IOBuf> release() && {
+    return std::move(buf_);
+  }
+
+ private:
+  std::unique_ptr<folly::IOBuf> buf_;
+};
+
+/*
+ * IOBufStringCodec is StringCodec without the copies: inbound IOBufs are
+ * wrapped in an IOBufString, and outbound strings are handed to an IOBuf
+ * that takes ownership of them. Strings shorter than kMinOwnedLength are
+ * still copied, as that is cheaper than the two small allocations owning
+ * them takes.
+ */
+class IOBufStringCodec : public Handler<
+                             std::unique_ptr<folly::IOBuf>,
+                             IOBufString,
+                             std::string,
+                             std::unique_ptr<folly::IOBuf>> {
+ public:
+  using Context = typename Handler<
+      std::unique_ptr<folly::IOBuf>,
+      IOBufString,
+      std::string,
+      std::unique_ptr<folly::IOBuf>>::Context;
+
+  static constexpr size_t kMinOwnedLength = 256;
+
+  void read(Context* ctx, std::unique_ptr<folly::IOBuf> buf) override {
+    if (buf) {
+      ctx->fireRead(IOBufString(std::move(buf)));
+    }
+  }
+
+  folly::Future<folly::Unit> write(Context* ctx, std::string msg) override {
+    if (msg.size() < kMinOwnedLength) {
+      return ctx->fireWrite(folly::IOBuf::copyBuffer(msg.data(), msg.size()));
+    }
+    auto str = new std::string(std::move(msg));
+    return ctx->fireWrite(
+        folly::IOBuf::takeOwnership(str->data(), str->size(), freeString, str));
+  }
+
+ private:
+  static void freeString(void* /*buf*/, void* userData) {
+    delete static_cast<std::string*>(userData);
+  }
+};
+
+} // namespace wangle
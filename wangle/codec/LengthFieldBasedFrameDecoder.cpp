@@ -44,9 +44,10 @@ bool LengthFieldBasedFrameDecoder::decode(
     Context* ctx,
     IOBufQueue& buf,
     std::unique_ptr<IOBuf>& result,
-    size_t&) {
+    size_t& needed) {
   // discarding too long frame
   if (buf.chainLength() < lengthFieldEndOffset_) {
+    needed = lengthFieldEndOffset_ - buf.chainLength();
     return false;
   }
 
@@ -71,6 +72,7 @@ bool LengthFieldBasedFrameDecoder::decode(
   }
 
   if (buf.chainLength() < frameLength) {
+    needed = frameLength - buf.chainLength();
     return false;
   }
 
@@ -198,7 +198,7 @@ class LengthFieldBasedFrameDecoder : public ByteToByteDecoder {
       Context* ctx,
       folly::IOBufQueue& buf,
       std::unique_ptr<folly::IOBuf>& result,
-      size_t&) override;
+      size_t& needed) override;
 
  private:
   uint64_t getUnadjustedFrameLength(
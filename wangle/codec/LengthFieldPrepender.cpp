@@ -49,8 +49,16 @@ Future<Unit> LengthFieldPrepender::write(
     throw std::runtime_error("Length field < 0");
   }
 
-  auto len = IOBuf::create(lengthFieldLength_);
-  len->append(lengthFieldLength_);
+  std::unique_ptr<IOBuf> len;
+  if (!buf->isSharedOne() && buf->headroom() >= size_t(lengthFieldLength_)) {
+    // Saves allocating the length field and a separate iovec for it.
+    buf->prepend(lengthFieldLength_);
+    len = std::move(buf);
+  } else {
+    len = IOBuf::create(lengthFieldLength_);
+    len->append(lengthFieldLength_);
+    len->prependChain(std::move(buf));
+  }
   folly::io::RWPrivateCursor c(len.get());
 
   switch (lengthFieldLength_) {
@@ -97,7 +105,6 @@ Future<Unit> LengthFieldPrepender::write(
     }
   }
 
-  len->prependChain(std::move(buf));
   return ctx->fireWrite(std::move(len));
 }
 
@@ -46,6 +46,10 @@ namespace wangle {
  * + 0x000E | "HELLO, WORLD" |
  * +--------+----------------+
  *
+ * If the first IOBuf of the message is not shared and has enough headroom,
+ * the length is written into the headroom rather than into a new IOBuf
+ * prepended to the chain. Serializers can allocate their buffers with
+ * createBuffer() or copyBuffer() to get that headroom.
  */
 class LengthFieldPrepender : public OutboundBytesToBytesHandler {
  public:
@@ -59,6 +63,21 @@ class LengthFieldPrepender : public OutboundBytesToBytesHandler {
       Context* ctx,
       std::unique_ptr<folly::IOBuf> buf) override;
 
+  // Headroom for the longest length field.
+  static constexpr size_t kHeadroom = 8;
+
+  // An empty buffer of the given capacity, with headroom for the length.
+  static std::unique_ptr<folly::IOBuf> createBuffer(size_t capacity) {
+    auto buf = folly::IOBuf::create(kHeadroom + capacity);
+    buf->advance(kHeadroom);
+    return buf;
+  }
+
+  // A copy of data, with headroom for the length.
+  static std::unique_ptr<folly::IOBuf> copyBuffer(folly::StringPiece data) {
+    return folly::IOBuf::copyBuffer(data, kHeadroom);
+  }
+
  private:
   int lengthFieldLength_;
   int lengthAdjustment_;
@@ -16,6 +16,9 @@
 
 #include <wangle/codec/LineBasedFrameDecoder.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace wangle {
 
 using folly::IOBuf;
@@ -36,6 +39,10 @@ bool LineBasedFrameDecoder::decode(
     std::unique_ptr<IOBuf>& result,
     size_t&) {
   int64_t eol = findEndOfLine(buf);
+  if (eol >= 0 || discarding_ || buf.chainLength() > maxLength_) {
+    // The front of the queue is about to be consumed.
+    resetScan();
+  }
 
   if (!discarding_) {
     if (eol >= 0) {
@@ -94,19 +101,89 @@ void LineBasedFrameDecoder::fail(Context* ctx, std::string len) {
 }
 
 int64_t LineBasedFrameDecoder::findEndOfLine(IOBufQueue& buf) {
-  Cursor c(buf.front());
-  for (uint32_t i = 0; i < maxLength_ && i < buf.chainLength(); i++) {
-    auto b = c.read<char>();
-    if (b == '\n' && terminatorType_ != TerminatorType::CARRIAGENEWLINE) {
-      return i;
-    } else if (
-        terminatorType_ != TerminatorType::NEWLINE && b == '\r' &&
-        !c.isAtEnd() && *c.peekBytes().data() == '\n') {
-      return i;
+  const IOBuf* head = buf.front();
+  if (!head) {
+    return -1;
+  }
+  // The '\n' of a "\r\n" may sit right after the first maxLength_ bytes.
+  const uint64_t limit =
+      std::min<uint64_t>(buf.chainLength(), uint64_t(maxLength_) + 1);
+
+  const IOBuf* segment = head;
+  uint64_t offset = 0;
+  bool afterCarriageReturn = false;
+  if (scanSegment_) {
+    // Pick up in the IOBuf where the last scan stopped instead of walking
+    // the chain from the head, which with many small reads would make
+    // finding a line quadratic in their number.
+    segment = scanSegment_;
+    offset = scanSegmentOffset_;
+    afterCarriageReturn = scanAfterCarriageReturn_;
+  }
+  while (true) {
+    const uint64_t segmentEnd = offset + segment->length();
+    const uint64_t end = std::min(segmentEnd, limit);
+    uint64_t begin = std::max(offset, scanned_);
+    while (begin < end) {
+      const auto data = segment->data();
+      const auto newline = static_cast<const uint8_t*>(
+          memchr(data + (begin - offset), '\n', end - begin));
+      if (!newline) {
+        break;
+      }
+      const uint64_t pos = offset + (newline - data);
+      int64_t eol = endOfLineAt(
+          pos, newline == data ? afterCarriageReturn : newline[-1] == '\r');
+      if (eol >= 0) {
+        return eol;
+      }
+      begin = pos + 1;
+    }
+    scanned_ = std::max(scanned_, end);
+    // The last IOBuf may still grow, so the next scan starts in it.
+    if (segmentEnd >= limit || segment->next() == head) {
+      break;
     }
+    if (segment->length() > 0) {
+      afterCarriageReturn = segment->data()[segment->length() - 1] == '\r';
+    }
+    offset = segmentEnd;
+    segment = segment->next();
   }
 
+  scanSegment_ = segment;
+  scanSegmentOffset_ = offset;
+  scanAfterCarriageReturn_ = afterCarriageReturn;
   return -1;
 }
 
+void LineBasedFrameDecoder::resetScan() {
+  scanned_ = 0;
+  scanSegment_ = nullptr;
+  scanSegmentOffset_ = 0;
+  scanAfterCarriageReturn_ = false;
+}
+
+int64_t LineBasedFrameDecoder::endOfLineAt(
+    uint64_t pos,
+    bool afterCarriageReturn) const {
+  int64_t eol;
+  switch (terminatorType_) {
+    case TerminatorType::NEWLINE:
+      eol = pos;
+      break;
+    case TerminatorType::CARRIAGENEWLINE:
+      if (!afterCarriageReturn) {
+        return -1;
+      }
+      eol = pos - 1;
+      break;
+    case TerminatorType::BOTH:
+    default:
+      eol = afterCarriageReturn ? pos - 1 : pos;
+      break;
+  }
+  return eol < int64_t(maxLength_) ? eol : -1;
+}
+
 } // namespace wangle
@@ -26,6 +26,11 @@ namespace wangle {
  *
  * Both "\n" and "\r\n" are handled, or optionally reqire only
  * one or the other.
+ *
+ * Lines are found with memchr() over each IOBuf in the chain, and the
+ * decoder remembers how far it has searched and in which IOBuf, so a long
+ * line arriving in many reads has every byte looked at once. This relies on
+ * only the decoder removing bytes from the front of the queue.
  */
 class LineBasedFrameDecoder : public ByteToByteDecoder {
  public:
@@ -45,6 +50,13 @@ class LineBasedFrameDecoder : public ByteToByteDecoder {
  private:
   int64_t findEndOfLine(folly::IOBufQueue& buf);
 
+  // Forgets how far the queue was searched, when its front is consumed.
+  void resetScan();
+
+  // Returns where the line ended by the '\n' at pos ends, or -1 if that
+  // '\n' does not end one.
+  int64_t endOfLineAt(uint64_t pos, bool afterCarriageReturn) const;
+
   void fail(Context* ctx, std::string len);
 
   uint32_t maxLength_;
@@ -52,6 +64,13 @@ class LineBasedFrameDecoder : public ByteToByteDecoder {
 
   bool discarding_{false};
   uint32_t discardedBytes_{0};
+  // Bytes at the front of the queue known not to hold an end of line.
+  uint64_t scanned_{0};
+  // The IOBuf the last scan stopped in, its offset in the queue, and whether
+  // the IOBuf before it ended in '\r'.
+  const folly::IOBuf* scanSegment_{nullptr};
+  uint64_t scanSegmentOffset_{0};
+  bool scanAfterCarriageReturn_{false};
 
   TerminatorType terminatorType_;
 };
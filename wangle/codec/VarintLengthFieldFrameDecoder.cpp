@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/VarintLengthFieldFrameDecoder.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/Varint.h>
+#include <folly/io/Cursor.h>
+
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+namespace wangle {
+
+bool VarintLengthFieldFrameDecoder::decode(
+    Context* ctx,
+    IOBufQueue& buf,
+    std::unique_ptr<IOBuf>& result,
+    size_t& needed) {
+  while (true) {
+    if (bytesToDiscard_ > 0 && !discardFrame(buf)) {
+      return false;
+    }
+
+    uint64_t length;
+    auto lengthFieldLength = readLength(ctx, buf, length);
+    if (lengthFieldLength == 0) {
+      needed = 1;
+      return false;
+    }
+
+    if (length > maxFrameLength_) {
+      ctx->fireReadException(
+          folly::make_exception_wrapper<std::runtime_error>(
+              "Frame larger than " + folly::to<std::string>(maxFrameLength_)));
+      bytesToDiscard_ = lengthFieldLength +
+          std::min(
+              length, std::numeric_limits<uint64_t>::max() - lengthFieldLength);
+      continue;
+    }
+
+    uint64_t frameLength = lengthFieldLength + length;
+    if (buf.chainLength() < frameLength) {
+      needed = frameLength - buf.chainLength();
+      return false;
+    }
+
+    if (stripLengthField_) {
+      buf.trimStart(lengthFieldLength);
+      result = buf.split(length);
+    } else {
+      result = buf.split(frameLength);
+    }
+    return true;
+  }
+}
+
+size_t VarintLengthFieldFrameDecoder::readLength(
+    Context* ctx,
+    IOBufQueue& buf,
+    uint64_t& length) {
+  const IOBuf* head = buf.front();
+  if (!head) {
+    return 0;
+  }
+
+  // Usually the whole length field is in the first IOBuf.
+  folly::ByteRange range(head->data(), head->length());
+  auto decoded = folly::tryDecodeVarint(range);
+  if (decoded.hasValue()) {
+    length = decoded.value();
+    return range.begin() - head->data();
+  }
+
+  if (decoded.error() == folly::DecodeVarintError::TooFewBytes) {
+    // It continues into the next IOBufs, read it a byte at a time.
+    folly::io::Cursor c(head);
+    length = 0;
+    for (size_t i = 0; i < folly::kMaxVarintLength64; i++) {
+      if (c.isAtEnd()) {
+        return 0;
+      }
+      auto byte = c.read<uint8_t>();
+      length |= uint64_t(byte & 0x7f) << (7 * i);
+      if (!(byte & 0x80)) {
+        return i + 1;
+      }
+    }
+  }
+
+  buf.trimStart(buf.chainLength());
+  ctx->fireReadException(
+      folly::make_exception_wrapper<std::runtime_error>(
+          "Length field longer than " +
+          folly::to<std::string>(folly::kMaxVarintLength64) + " bytes"));
+  return 0;
+}
+
+bool VarintLengthFieldFrameDecoder::discardFrame(IOBufQueue& buf) {
+  auto discarded = buf.trimStartAtMost(bytesToDiscard_);
+  bytesToDiscard_ -= discarded;
+  return bytesToDiscard_ == 0;
+}
+
+} // namespace wangle
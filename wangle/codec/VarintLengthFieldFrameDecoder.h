@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <climits>
+
+#include <wangle/codec/ByteToMessageDecoder.h>
+
+namespace wangle {
+
+/**
+ * A decoder that splits the received IOBufQueue by a length field encoded as
+ * a varint (LEB128, as in protocol buffers): 7 bits per byte, least
+ * significant group first, the high bit set on all but the last byte.
+ *
+ * BEFORE DECODE (13 bytes)             AFTER DECODE (12 bytes)
+ * +--------+----------------+          +----------------+
+ * | Length | Actual Content |--------->| Actual Content |
+ * |  0x0C  | "HELLO, WORLD" |          | "HELLO, WORLD" |
+ * +--------+----------------+          +----------------+
+ *
+ * The length counts the content only. Content longer than maxFrameLength
+ * fires readException and is discarded as it arrives. A length field
+ * longer than 10 bytes cannot be a 64 bit varint; the stream is broken
+ * past recovery, so readException is fired and everything buffered is
+ * dropped.
+ *
+ * @see VarintLengthFieldPrepender
+ */
+class VarintLengthFieldFrameDecoder : public ByteToByteDecoder {
+ public:
+  explicit VarintLengthFieldFrameDecoder(
+      uint32_t maxFrameLength = UINT_MAX,
+      bool stripLengthField = true)
+      : maxFrameLength_(maxFrameLength), stripLengthField_(stripLengthField) {}
+
+  bool decode(
+      Context* ctx,
+      folly::IOBufQueue& buf,
+      std::unique_ptr<folly::IOBuf>& result,
+      size_t& needed) override;
+
+ private:
+  // Reads the length field at the front of buf. Returns its size in bytes,
+  // or 0 if all of it hasn't arrived yet.
+  size_t readLength(Context* ctx, folly::IOBufQueue& buf, uint64_t& length);
+
+  // Discards what has arrived of a frame that is too long. Returns true once
+  // all of it has been discarded.
+  bool discardFrame(folly::IOBufQueue& buf);
+
+  uint32_t maxFrameLength_;
+  bool stripLengthField_;
+
+  uint64_t bytesToDiscard_{0};
+};
+
+} // namespace wangle
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <wangle/codec/VarintLengthFieldPrepender.h>
+
+#include <cstring>
+
+#include <folly/Varint.h>
+
+using folly::Future;
+using folly::IOBuf;
+using folly::Unit;
+
+namespace wangle {
+
+Future<Unit> VarintLengthFieldPrepender::write(
+    Context* ctx,
+    std::unique_ptr<IOBuf> buf) {
+  uint8_t field[folly::kMaxVarintLength64];
+  size_t fieldLength =
+      folly::encodeVarint(buf->computeChainDataLength(), field);
+
+  if (!buf->isSharedOne() && buf->headroom() >= fieldLength) {
+    buf->prepend(fieldLength);
+    std::memcpy(buf->writableData(), field, fieldLength);
+    return ctx->fireWrite(std::move(buf));
+  }
+
+  auto len = IOBuf::copyBuffer(field, fieldLength);
+  len->prependChain(std::move(buf));
+  return ctx->fireWrite(std::move(len));
+}
+
+} // namespace wangle
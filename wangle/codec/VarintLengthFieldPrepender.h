@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <wangle/channel/Handler.h>
+
+namespace wangle {
+
+/**
+ * An encoder that prepends the length of the message as a varint (LEB128),
+ * which takes one byte for messages shorter than 128 bytes and two for those
+ * shorter than 16 KiB.
+ *
+ * Like LengthFieldPrepender, it writes the length into the headroom of the
+ * first IOBuf when that is not shared and has room for it, and otherwise
+ * into a new IOBuf in front of the message. LengthFieldPrepender::
+ * createBuffer() leaves enough headroom for lengths below 2^56.
+ *
+ * @see VarintLengthFieldFrameDecoder
+ */
+class VarintLengthFieldPrepender : public OutboundBytesToBytesHandler {
+ public:
+  folly::Future<folly::Unit> write(
+      Context* ctx,
+      std::unique_ptr<folly::IOBuf> buf) override;
+};
+
+} // namespace wangle
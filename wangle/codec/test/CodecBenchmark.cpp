@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Varint.h>
+#include <folly/hash/Checksum.h>
+#include <folly/init/Init.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <wangle/channel/Handler.h>
+#include <wangle/channel/Pipeline.h>
+#include <wangle/codec/Crc32cDecoder.h>
+#include <wangle/codec/Crc32cEncoder.h>
+#include <wangle/codec/DelimiterBasedFrameDecoder.h>
+#include <wangle/codec/FixedLengthFrameDecoder.h>
+#include <wangle/codec/LengthFieldBasedFrameDecoder.h>
+#include <wangle/codec/LengthFieldPrepender.h>
+#include <wangle/codec/LineBasedFrameDecoder.h>
+#include <wangle/codec/VarintLengthFieldFrameDecoder.h>
+#include <wangle/codec/VarintLengthFieldPrepender.h>
+
+using namespace wangle;
+using folly::IOBuf;
+using folly::IOBufQueue;
+
+/*
+ * Every decoder benchmark iteration feeds 1 MiB of input, cut into segments
+ * the way a transport would deliver it, through a decoder into a sink. Every
+ * encoder benchmark iteration writes 1 MiB of messages. The time per
+ * iteration is the time per MiB, so iters/s is the throughput in MiB/s, and
+ * frames/s is that times the number of frames of the benchmark's size in a
+ * MiB.
+ */
+
+namespace {
+
+constexpr size_t kInputSize = 1024 * 1024;
+// Roughly a TCP segment.
+constexpr size_t kSegmentSize = 1460;
+// Small reads, each of which costs a call through the pipeline.
+constexpr size_t kTinySegmentSize = 64;
+
+class FrameSink : public InboundHandler<std::unique_ptr<IOBuf>> {
+ public:
+  void read(Context*, std::unique_ptr<IOBuf> frame) override {
+    folly::doNotOptimizeAway(frame);
+    frames++;
+  }
+
+  size_t frames{0};
+};
+
+// Lines of lineLength bytes, each including its delimiter, until size bytes.
+std::string makeLines(size_t size, size_t lineLength, const std::string& eol) {
+  std::string line(lineLength - eol.size(), 'x');
+  line += eol;
+  std::string input;
+  input.reserve(size);
+  while (input.size() + line.size() <= size) {
+    input += line;
+  }
+  return input;
+}
+
+std::vector<std::unique_ptr<IOBuf>> makeSegments(
+    const std::string& input,
+    size_t segmentSize) {
+  std::vector<std::unique_ptr<IOBuf>> segments;
+  for (size_t offset = 0; offset < input.size(); offset += segmentSize) {
+    segments.push_back(IOBuf::copyBuffer(
+        input.data() + offset, std::min(segmentSize, input.size() - offset)));
+  }
+  return segments;
+}
+
+void appendBE32(std::string& s, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    s += static_cast<char>(value >> shift);
+  }
+}
+
+// Frames with frameLength bytes of content after a fixed 4 byte or a varint
+// length field, until size bytes. With crc the content ends in the trailer
+// Crc32cEncoder would have appended.
+std::string makeLengthFrames(
+    size_t size,
+    size_t frameLength,
+    bool varint,
+    bool crc = false) {
+  std::string content(frameLength, 'x');
+  if (crc) {
+    appendBE32(
+        content,
+        folly::crc32c(
+            reinterpret_cast<const uint8_t*>(content.data()), content.size()));
+  }
+  std::string frame;
+  if (varint) {
+    uint8_t field[folly::kMaxVarintLength64];
+    auto fieldLength = folly::encodeVarint(content.size(), field);
+    frame.assign(reinterpret_cast<char*>(field), fieldLength);
+  } else {
+    appendBE32(frame, content.size());
+  }
+  frame += content;
+  std::string input;
+  input.reserve(size);
+  while (input.size() + frame.size() <= size) {
+    input += frame;
+  }
+  return input;
+}
+
+// Feeds input through decoder and then handlers.
+template <class Decoder, class... Handlers>
+void decodeInput(
+    size_t iters,
+    Decoder decoder,
+    const std::string& input,
+    size_t segmentSize,
+    Handlers... handlers) {
+  folly::BenchmarkSuspender suspender;
+  auto segments = makeSegments(input, segmentSize);
+  FrameSink sink;
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  pipeline->addBack(std::move(decoder));
+  (pipeline->addBack(std::move(handlers)), ...);
+  pipeline->addBack(&sink).finalize();
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    for (const auto& segment : segments) {
+      q.append(segment->clone());
+      pipeline->read(q);
+    }
+  }
+  folly::doNotOptimizeAway(sink.frames);
+}
+
+template <class Decoder>
+void decodeLines(
+    size_t iters,
+    Decoder decoder,
+    size_t lineLength,
+    const std::string& eol,
+    size_t segmentSize) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input = makeLines(kInputSize, lineLength, eol);
+  }
+  decodeInput(iters, std::move(decoder), input, segmentSize);
+}
+
+template <class Decoder>
+void decodeLengthFrames(
+    size_t iters,
+    Decoder decoder,
+    size_t frameLength,
+    bool varint) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input = makeLengthFrames(kInputSize, frameLength, varint);
+  }
+  decodeInput(iters, std::move(decoder), input, kSegmentSize);
+}
+
+class WriteSink : public OutboundBytesToBytesHandler {
+ public:
+  folly::Future<folly::Unit> write(Context*, std::unique_ptr<IOBuf> buf)
+      override {
+    folly::doNotOptimizeAway(buf);
+    return folly::makeFuture();
+  }
+};
+
+// Writes messages of messageLength bytes, allocated the way a serializer
+// would, with or without headroom for the length field, through handlers
+// and then prepender.
+template <class Prepender, class... Handlers>
+void encodeMessages(
+    size_t iters,
+    Prepender prepender,
+    size_t messageLength,
+    bool headroom,
+    Handlers... handlers) {
+  folly::BenchmarkSuspender suspender;
+  WriteSink sink;
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  pipeline->addBack(&sink).addBack(std::move(prepender));
+  (pipeline->addBack(std::move(handlers)), ...);
+  pipeline->finalize();
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    for (size_t n = 0; n < kInputSize / messageLength; ++n) {
+      auto buf = headroom ? LengthFieldPrepender::createBuffer(messageLength)
+                          : IOBuf::create(messageLength);
+      buf->append(messageLength);
+      pipeline->write(std::move(buf));
+    }
+  }
+}
+
+} // namespace
+
+// Interactive, telnet-like traffic: short "\r\n" lines.
+BENCHMARK(LineBasedFrameDecoder_Telnet_80B_Lines, iters) {
+  decodeLines(iters, LineBasedFrameDecoder(), 80, "\r\n", kSegmentSize);
+}
+
+// A text RPC protocol: one request of about 1 KiB per "\n" line.
+BENCHMARK_RELATIVE(LineBasedFrameDecoder_TextRpc_1KiB_Lines, iters) {
+  decodeLines(
+      iters,
+      LineBasedFrameDecoder(
+          UINT_MAX, true, LineBasedFrameDecoder::TerminatorType::NEWLINE),
+      1024,
+      "\n",
+      kSegmentSize);
+}
+
+// A single 1 MiB line arriving one segment at a time, which scans each byte
+// once only if the decoder remembers where it stopped.
+BENCHMARK_RELATIVE(LineBasedFrameDecoder_1MiB_Line, iters) {
+  decodeLines(
+      iters, LineBasedFrameDecoder(), kInputSize, "\r\n", kSegmentSize);
+}
+
+BENCHMARK_RELATIVE(LineBasedFrameDecoder_1MiB_Line_Contiguous, iters) {
+  decodeLines(
+      iters, LineBasedFrameDecoder(), kInputSize, "\r\n", kInputSize);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// The same telnet-like traffic split on a configurable delimiter.
+BENCHMARK(DelimiterBasedFrameDecoder_Telnet_80B_Lines, iters) {
+  decodeLines(
+      iters, DelimiterBasedFrameDecoder({"\r\n"}), 80, "\r\n", kSegmentSize);
+}
+
+// HTTP/1 style headers of about 512 bytes, ended by an empty line.
+BENCHMARK_RELATIVE(DelimiterBasedFrameDecoder_Http_512B_Headers, iters) {
+  decodeLines(
+      iters,
+      DelimiterBasedFrameDecoder({"\r\n\r\n"}),
+      512,
+      "\r\n\r\n",
+      kSegmentSize);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(LengthFieldBasedFrameDecoder_1KiB_Frames, iters) {
+  decodeLengthFrames(iters, LengthFieldBasedFrameDecoder(), 1024, false);
+}
+
+BENCHMARK_RELATIVE(VarintLengthFieldFrameDecoder_1KiB_Frames, iters) {
+  decodeLengthFrames(iters, VarintLengthFieldFrameDecoder(), 1024, true);
+}
+
+BENCHMARK(LengthFieldBasedFrameDecoder_64B_Frames, iters) {
+  decodeLengthFrames(iters, LengthFieldBasedFrameDecoder(), 64, false);
+}
+
+// Small frames, where reading the length field is more of the work.
+BENCHMARK_RELATIVE(VarintLengthFieldFrameDecoder_64B_Frames, iters) {
+  decodeLengthFrames(iters, VarintLengthFieldFrameDecoder(), 64, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(LengthFieldPrepender_1KiB_Messages, iters) {
+  encodeMessages(iters, LengthFieldPrepender(), 1024, false);
+}
+
+// The length is written into the headroom instead of a new IOBuf.
+BENCHMARK_RELATIVE(LengthFieldPrepender_1KiB_Messages_Headroom, iters) {
+  encodeMessages(iters, LengthFieldPrepender(), 1024, true);
+}
+
+BENCHMARK_RELATIVE(VarintLengthFieldPrepender_1KiB_Messages, iters) {
+  encodeMessages(iters, VarintLengthFieldPrepender(), 1024, false);
+}
+
+BENCHMARK_RELATIVE(VarintLengthFieldPrepender_1KiB_Messages_Headroom, iters) {
+  encodeMessages(iters, VarintLengthFieldPrepender(), 1024, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(LengthFieldBasedFrameDecoder_4KiB_Frames, iters) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input = makeLengthFrames(kInputSize, 4096, false);
+  }
+  decodeInput(iters, LengthFieldBasedFrameDecoder(), input, kSegmentSize);
+}
+
+// The same frames checked by CRC32C, which costs the difference.
+BENCHMARK_RELATIVE(Crc32cDecoder_4KiB_Frames, iters) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input = makeLengthFrames(kInputSize, 4096, false, true);
+  }
+  decodeInput(
+      iters,
+      LengthFieldBasedFrameDecoder(),
+      input,
+      kSegmentSize,
+      Crc32cDecoder());
+}
+
+BENCHMARK(LengthFieldPrepender_4KiB_Messages, iters) {
+  encodeMessages(iters, LengthFieldPrepender(), 4096, true);
+}
+
+BENCHMARK_RELATIVE(Crc32cEncoder_4KiB_Messages, iters) {
+  encodeMessages(iters, LengthFieldPrepender(), 4096, true, Crc32cEncoder());
+}
+
+/*
+ * The same matrix for each codec: frames of 16 B to 1 MiB, including their
+ * length field or delimiter, delivered as one contiguous buffer, as tiny
+ * segments, and as TCP sized segments that split frames across their
+ * boundaries. Work that grows faster than the input, such as rescanning
+ * everything buffered on each read, shows up as the tiny segment and large
+ * frame cases falling behind the rest.
+ */
+
+namespace {
+
+void decodeLineFrames(size_t iters, size_t frameLength, size_t segmentSize) {
+  decodeLines(iters, LineBasedFrameDecoder(), frameLength, "\r\n", segmentSize);
+}
+
+void decodeLengthFieldFrames(
+    size_t iters,
+    size_t frameLength,
+    size_t segmentSize) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input = makeLengthFrames(kInputSize, frameLength - 4, false);
+  }
+  decodeInput(iters, LengthFieldBasedFrameDecoder(), input, segmentSize);
+}
+
+void decodeFixedLengthFrames(
+    size_t iters,
+    size_t frameLength,
+    size_t segmentSize) {
+  std::string input;
+  BENCHMARK_SUSPEND {
+    input.assign(kInputSize - kInputSize % frameLength, 'x');
+  }
+  decodeInput(iters, FixedLengthFrameDecoder(frameLength), input, segmentSize);
+}
+
+// There is no input to segment when encoding, the messages are either
+// allocated with headroom for the length field or without.
+void encodeLengthFieldMessages(
+    size_t iters,
+    size_t messageLength,
+    bool headroom) {
+  encodeMessages(iters, LengthFieldPrepender(), messageLength, headroom);
+}
+
+} // namespace
+
+#define CODEC_DECODER_BENCHMARKS(decode, name, frameLength)                   \
+  BENCHMARK_NAMED_PARAM(                                                      \
+      decode, name##_Contiguous, frameLength, kInputSize)                     \
+  BENCHMARK_RELATIVE_NAMED_PARAM(                                             \
+      decode, name##_TinySegments, frameLength, kTinySegmentSize)             \
+  BENCHMARK_RELATIVE_NAMED_PARAM(                                             \
+      decode, name##_Split, frameLength, kSegmentSize)
+
+#define CODEC_DECODER_SUITE(decode)                                           \
+  CODEC_DECODER_BENCHMARKS(decode, 16B, 16)                                   \
+  CODEC_DECODER_BENCHMARKS(decode, 256B, 256)                                 \
+  CODEC_DECODER_BENCHMARKS(decode, 4KiB, 4096)                                \
+  CODEC_DECODER_BENCHMARKS(decode, 64KiB, 65536)                              \
+  CODEC_DECODER_BENCHMARKS(decode, 1MiB, kInputSize)
+
+BENCHMARK_DRAW_LINE();
+CODEC_DECODER_SUITE(decodeLineFrames)
+BENCHMARK_DRAW_LINE();
+CODEC_DECODER_SUITE(decodeLengthFieldFrames)
+BENCHMARK_DRAW_LINE();
+CODEC_DECODER_SUITE(decodeFixedLengthFrames)
+BENCHMARK_DRAW_LINE();
+
+#define CODEC_ENCODER_BENCHMARKS(encode, name, messageLength)                 \
+  BENCHMARK_NAMED_PARAM(encode, name, messageLength, false)                   \
+  BENCHMARK_RELATIVE_NAMED_PARAM(                                             \
+      encode, name##_Headroom, messageLength, true)
+
+CODEC_ENCODER_BENCHMARKS(encodeLengthFieldMessages, 16B, 16)
+CODEC_ENCODER_BENCHMARKS(encodeLengthFieldMessages, 256B, 256)
+CODEC_ENCODER_BENCHMARKS(encodeLengthFieldMessages, 4KiB, 4096)
+CODEC_ENCODER_BENCHMARKS(encodeLengthFieldMessages, 64KiB, 65536)
+CODEC_ENCODER_BENCHMARKS(encodeLengthFieldMessages, 1MiB, kInputSize)
+
+int main(int argc, char** argv) {
+  const folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
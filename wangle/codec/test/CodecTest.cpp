@@ -16,10 +16,18 @@
 
 #include <folly/portability/GTest.h>
 
+#include <wangle/codec/CompressionEncoder.h>
+#include <wangle/codec/Crc32cDecoder.h>
+#include <wangle/codec/Crc32cEncoder.h>
+#include <wangle/codec/DecompressionDecoder.h>
+#include <wangle/codec/DelimiterBasedFrameDecoder.h>
 #include <wangle/codec/FixedLengthFrameDecoder.h>
+#include <wangle/codec/IOBufStringCodec.h>
 #include <wangle/codec/LengthFieldBasedFrameDecoder.h>
 #include <wangle/codec/LengthFieldPrepender.h>
 #include <wangle/codec/LineBasedFrameDecoder.h>
+#include <wangle/codec/VarintLengthFieldFrameDecoder.h>
+#include <wangle/codec/VarintLengthFieldPrepender.h>
 #include <wangle/codec/test/CodecTestUtils.h>
 
 using namespace folly;
@@ -107,6 +115,49 @@ TEST(LengthFieldFramePipeline, LittleEndian) {
   EXPECT_EQ(called, 1);
 }
 
+namespace {
+class BytesCapture : public OutboundBytesToBytesHandler {
+ public:
+  folly::Future<folly::Unit> write(Context*, std::unique_ptr<IOBuf> buf)
+      override {
+    written = std::move(buf);
+    return folly::makeFuture();
+  }
+
+  std::unique_ptr<IOBuf> written;
+};
+} // namespace
+
+TEST(LengthFieldPrepender, Headroom) {
+  BytesCapture capture;
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  (*pipeline).addBack(&capture).addBack(LengthFieldPrepender(2)).finalize();
+
+  // The length is written in place in front of the message.
+  auto buf = LengthFieldPrepender::copyBuffer("hello");
+  auto data = buf->data();
+  pipeline->write(std::move(buf));
+  ASSERT_FALSE(capture.written->isChained());
+  EXPECT_EQ(data - 2, capture.written->data());
+  EXPECT_EQ(
+      std::string("\0\5hello", 7),
+      capture.written->moveToFbString().toStdString());
+
+  // Without headroom, or when another IOBuf shares it, the length goes in
+  // a new IOBuf in front.
+  auto shared = LengthFieldPrepender::copyBuffer("hello");
+  std::vector<std::unique_ptr<IOBuf>> msgs;
+  msgs.push_back(IOBuf::copyBuffer("hello"));
+  msgs.push_back(shared->clone());
+  for (auto& msg : msgs) {
+    pipeline->write(std::move(msg));
+    EXPECT_EQ(2, capture.written->countChainElements());
+    EXPECT_EQ(
+        std::string("\0\5hello", 7),
+        capture.written->moveToFbString().toStdString());
+  }
+}
+
 TEST(LengthFieldFrameDecoder, Simple) {
   auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
   int called = 0;
@@ -136,6 +187,142 @@ TEST(LengthFieldFrameDecoder, Simple) {
   EXPECT_EQ(called, 1);
 }
 
+namespace {
+class CountingLengthFieldDecoder : public LengthFieldBasedFrameDecoder {
+ public:
+  bool decode(
+      Context* ctx,
+      IOBufQueue& buf,
+      std::unique_ptr<IOBuf>& result,
+      size_t& needed) override {
+    decodes++;
+    return LengthFieldBasedFrameDecoder::decode(ctx, buf, result, needed);
+  }
+
+  int decodes{0};
+};
+} // namespace
+
+TEST(LengthFieldFrameDecoder, NeededBytes) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  int called = 0;
+  CountingLengthFieldDecoder decoder;
+
+  (*pipeline)
+      .addBack(&decoder)
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        called++;
+        EXPECT_EQ(buf->computeChainDataLength(), 100);
+      }))
+      .finalize();
+
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(createZeroedBuffer(2));
+  pipeline->read(q);
+  EXPECT_EQ(decoder.decodes, 1);
+  EXPECT_EQ(pipeline->getReadBytesExpected(), 2);
+
+  auto bufFrame = createZeroedBuffer(2);
+  RWPrivateCursor c(bufFrame.get());
+  c.writeBE<uint16_t>(100);
+  q.append(std::move(bufFrame));
+  pipeline->read(q);
+  EXPECT_EQ(decoder.decodes, 2);
+  EXPECT_EQ(pipeline->getReadBytesExpected(), 100);
+
+  // The header is not parsed again until the whole frame is there.
+  for (int i = 0; i < 9; i++) {
+    q.append(createZeroedBuffer(10));
+    pipeline->read(q);
+  }
+  EXPECT_EQ(decoder.decodes, 2);
+  EXPECT_EQ(pipeline->getReadBytesExpected(), 10);
+  EXPECT_EQ(called, 0);
+
+  q.append(createZeroedBuffer(10));
+  pipeline->read(q);
+  EXPECT_EQ(called, 1);
+  EXPECT_EQ(pipeline->getReadBytesExpected(), 4);
+}
+
+namespace {
+// Feeds each frame to the rest of the pipeline as a queue of its own, the
+// way a second framing stage would see it.
+class FrameToQueue
+    : public InboundHandler<std::unique_ptr<IOBuf>, IOBufQueue&> {
+ public:
+  void read(Context* ctx, std::unique_ptr<IOBuf> frame) override {
+    q_.append(std::move(frame));
+    ctx->fireRead(q_);
+  }
+
+ private:
+  IOBufQueue q_{IOBufQueue::cacheChainLength()};
+};
+} // namespace
+
+TEST(LengthFieldFrameDecoder, NestedNeededBytes) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  CountingLengthFieldDecoder inner;
+  (*pipeline)
+      .addBack(LineBasedFrameDecoder())
+      .addBack(FrameToQueue())
+      .addBack(&inner)
+      .addBack(test::FrameTester([](std::unique_ptr<IOBuf>) { FAIL(); }))
+      .finalize();
+
+  // The inner decoder waits for the rest of its frame, but that is not what
+  // the transport reads next, so it must not size the transport's reads.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer(std::string("\0\0\0\x64" "ab\n", 7)));
+  pipeline->read(q);
+  EXPECT_EQ(inner.decodes, 1);
+  EXPECT_EQ(pipeline->getReadBytesExpected(), 0);
+}
+
+namespace {
+// Feeds each frame to another pipeline, the way a proxy or multiplexer
+// would.
+class FrameToPipeline : public InboundHandler<std::unique_ptr<IOBuf>> {
+ public:
+  explicit FrameToPipeline(
+      std::shared_ptr<Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>> other)
+      : other_(std::move(other)) {}
+
+  void read(Context*, std::unique_ptr<IOBuf> frame) override {
+    q_.append(std::move(frame));
+    other_->read(q_);
+  }
+
+ private:
+  std::shared_ptr<Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>> other_;
+  IOBufQueue q_{IOBufQueue::cacheChainLength()};
+};
+} // namespace
+
+TEST(LengthFieldFrameDecoder, NeededBytesAcrossPipelines) {
+  auto inner = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  CountingLengthFieldDecoder decoder;
+  (*inner)
+      .addBack(&decoder)
+      .addBack(test::FrameTester([](std::unique_ptr<IOBuf>) { FAIL(); }))
+      .finalize();
+  auto outer = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  (*outer)
+      .addBack(LineBasedFrameDecoder())
+      .addBack(FrameToPipeline(inner))
+      .finalize();
+
+  // Each pipeline's first decoder sets its own pipeline's value, even when
+  // one pipeline is read from within the other's read.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer(std::string("\0\0\0\x64" "ab\n", 7)));
+  outer->read(q);
+  EXPECT_EQ(decoder.decodes, 1);
+  EXPECT_EQ(inner->getReadBytesExpected(), 98);
+  EXPECT_EQ(outer->getReadBytesExpected(), 0);
+}
+
 TEST(LengthFieldFrameDecoder, NoStrip) {
   auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
   int called = 0;
@@ -641,3 +828,619 @@ TEST(LineBasedFrameDecoder, DoubleCarriage) {
   pipeline->read(q);
   EXPECT_EQ(called, 2);
 }
+
+namespace {
+class BatchRecorder
+    : public wangle::InboundHandler<std::unique_ptr<folly::IOBuf>> {
+ public:
+  void read(Context*, std::unique_ptr<folly::IOBuf> buf) override {
+    sizes.push_back(1);
+    bytes += buf->computeChainDataLength();
+  }
+
+  void readBatch(Context*, ReadBatch<std::unique_ptr<folly::IOBuf>>& bufs)
+      override {
+    sizes.push_back(bufs.size());
+    for (auto& buf : bufs) {
+      bytes += buf->computeChainDataLength();
+    }
+  }
+
+  std::vector<size_t> sizes;
+  size_t bytes{0};
+};
+} // namespace
+
+TEST(ByteToMessageDecoder, ReadBatch) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  FixedLengthFrameDecoder decoder(2);
+  decoder.setMaxReadBatch(3);
+  BatchRecorder recorder;
+  (*pipeline).addBack(std::move(decoder)).addBack(&recorder).finalize();
+
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(createZeroedBuffer(15));
+  pipeline->read(q);
+  EXPECT_EQ((std::vector<size_t>{3, 3, 1}), recorder.sizes);
+  EXPECT_EQ(14, recorder.bytes);
+  EXPECT_EQ(1, q.chainLength());
+}
+
+TEST(ByteToMessageDecoder, ReadBatchFallback) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  int called = 0;
+  FixedLengthFrameDecoder decoder(2);
+  decoder.setMaxReadBatch(4);
+  (*pipeline)
+      .addBack(std::move(decoder))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        called++;
+        EXPECT_EQ(buf->computeChainDataLength(), 2);
+      }))
+      .finalize();
+
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(createZeroedBuffer(14));
+  pipeline->read(q);
+  EXPECT_EQ(called, 7);
+}
+
+TEST(LineBasedFrameDecoder, SplitAcrossReads) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> lines;
+
+  (*pipeline)
+      .addBack(LineBasedFrameDecoder(
+          10, true, LineBasedFrameDecoder::TerminatorType::CARRIAGENEWLINE))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        lines.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // One byte per read, with a lone "\n" that does not end a line and a
+  // "\r\n" split between reads.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  for (char c : std::string("ab\ncd\r\nef\r\n")) {
+    q.append(IOBuf::copyBuffer(&c, 1));
+    pipeline->read(q);
+  }
+  EXPECT_EQ((std::vector<std::string>{"ab\ncd", "ef"}), lines);
+  EXPECT_EQ(0, q.chainLength());
+}
+
+TEST(LineBasedFrameDecoder, PackedReads) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> lines;
+
+  (*pipeline)
+      .addBack(LineBasedFrameDecoder())
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        lines.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // Reads packed into the IOBuf the last scan stopped in are still found.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  for (auto read : {"ab", "cd\r", "\nef", "\n"}) {
+    q.append(IOBuf::copyBuffer(read), true);
+    pipeline->read(q);
+  }
+  EXPECT_EQ((std::vector<std::string>{"abcd", "ef"}), lines);
+  EXPECT_EQ(0, q.chainLength());
+}
+
+TEST(DelimiterBasedFrameDecoder, ShortestFrame) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> frames;
+
+  (*pipeline)
+      .addBack(DelimiterBasedFrameDecoder({"\r\n", "\n"}))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        frames.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer("ABC\nDEF\r\n\nGHI"));
+  pipeline->read(q);
+  EXPECT_EQ((std::vector<std::string>{"ABC", "DEF", ""}), frames);
+  EXPECT_EQ(3, q.chainLength());
+}
+
+TEST(DelimiterBasedFrameDecoder, SplitAcrossReads) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> frames;
+
+  (*pipeline)
+      .addBack(DelimiterBasedFrameDecoder({"\r\n\r\n"}, 100, false))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        frames.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // The delimiter is split between IOBufs and reads, and an "\r\n" that
+  // only starts one must not end the frame.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  for (const char* part : {"GET / HTTP/1.1\r", "\nHost: a\r\n", "\r", "\nX"}) {
+    q.append(IOBuf::copyBuffer(part));
+    pipeline->read(q);
+  }
+  EXPECT_EQ(
+      (std::vector<std::string>{"GET / HTTP/1.1\r\nHost: a\r\n\r\n"}), frames);
+  EXPECT_EQ(1, q.chainLength());
+}
+
+TEST(DelimiterBasedFrameDecoder, Fail) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> frames;
+  int failed = 0;
+
+  (*pipeline)
+      .addBack(DelimiterBasedFrameDecoder({std::string(1, '\0')}, 4))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        if (!buf) {
+          failed++;
+          return;
+        }
+        frames.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer("abcde"));
+  pipeline->read(q);
+  EXPECT_EQ(1, failed);
+  EXPECT_EQ(0, q.chainLength());
+
+  // The rest of the long frame is discarded up to the delimiter.
+  q.append(IOBuf::copyBuffer("fgh"));
+  pipeline->read(q);
+  q.append(IOBuf::copyBuffer(std::string("ij\0klmn\0", 8)));
+  pipeline->read(q);
+  EXPECT_EQ(1, failed);
+  EXPECT_EQ((std::vector<std::string>{"klmn"}), frames);
+}
+
+TEST(VarintLengthFieldFramePipeline, RoundTrip) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<size_t> sizes;
+
+  (*pipeline)
+      .addBack(test::BytesReflector())
+      .addBack(VarintLengthFieldPrepender())
+      .addBack(VarintLengthFieldFrameDecoder())
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        sizes.push_back(buf->computeChainDataLength());
+      }))
+      .finalize();
+
+  // One, two and three byte length fields.
+  std::vector<size_t> expected{0, 1, 127, 128, 16383, 16384, 70000};
+  for (auto size : expected) {
+    pipeline->write(createZeroedBuffer(size));
+  }
+  EXPECT_EQ(expected, sizes);
+}
+
+TEST(VarintLengthFieldFrameDecoder, SplitLengthField) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> frames;
+
+  (*pipeline)
+      .addBack(VarintLengthFieldFrameDecoder(1000, false))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        frames.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // 300 is 0xAC 0x02, the two bytes arrive in separate IOBufs.
+  std::string frame = "\xAC\x02" + std::string(300, 'a');
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer(frame.data(), 1));
+  pipeline->read(q);
+  EXPECT_TRUE(frames.empty());
+  q.append(IOBuf::copyBuffer(frame.data() + 1, frame.size() - 1));
+  pipeline->read(q);
+  EXPECT_EQ(std::vector<std::string>{frame}, frames);
+}
+
+TEST(VarintLengthFieldFrameDecoder, Fail) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> frames;
+  int failed = 0;
+
+  (*pipeline)
+      .addBack(VarintLengthFieldFrameDecoder(4))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        if (!buf) {
+          failed++;
+          return;
+        }
+        frames.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // The too long frame is discarded as it arrives.
+  IOBufQueue q(IOBufQueue::cacheChainLength());
+  q.append(IOBuf::copyBuffer("\x05" "abc"));
+  pipeline->read(q);
+  EXPECT_EQ(1, failed);
+  EXPECT_EQ(0, q.chainLength());
+  q.append(IOBuf::copyBuffer("de\x02" "fg"));
+  pipeline->read(q);
+  EXPECT_EQ(1, failed);
+  EXPECT_EQ(std::vector<std::string>{"fg"}, frames);
+
+  // A length field of more than 10 bytes drops everything.
+  q.append(IOBuf::copyBuffer(std::string(11, '\x80') + "\x01"));
+  pipeline->read(q);
+  EXPECT_EQ(2, failed);
+  EXPECT_EQ(0, q.chainLength());
+}
+
+namespace {
+// Compresses well, but not to nothing.
+std::string makeText(size_t size) {
+  std::string text;
+  for (size_t i = 0; text.size() < size; i++) {
+    text += "message " + folly::to<std::string>(i % 1000) + ", ";
+  }
+  text.resize(size);
+  return text;
+}
+} // namespace
+
+TEST(CompressionEncoder, PerFrame) {
+  if (!io::hasCodec(io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  BytesCapture capture;
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  CompressionEncoder::Options options;
+  options.minCompressLength = 64;
+  (*pipeline).addBack(&capture).addBack(CompressionEncoder(options)).finalize();
+
+  // Short messages go out as they are, after the header byte.
+  pipeline->write(IOBuf::copyBuffer("hello"));
+  EXPECT_EQ(
+      std::string("\0hello", 6),
+      capture.written->moveToFbString().toStdString());
+
+  auto text = makeText(4096);
+  pipeline->write(IOBuf::copyBuffer(text));
+  auto written = capture.written->moveToFbString().toStdString();
+  EXPECT_LT(written.size(), text.size() / 2);
+  // Compressed, then the uncompressed length as a varint.
+  EXPECT_EQ(std::string("\1\x80\x20", 3), written.substr(0, 3));
+}
+
+TEST(CompressionEncoder, PerFramePipeline) {
+  if (!io::hasCodec(io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> msgs;
+  int failed = 0;
+
+  CompressionEncoder::Options options;
+  options.minCompressLength = 64;
+  (*pipeline)
+      .addBack(test::BytesReflector())
+      .addBack(LengthFieldBasedFrameDecoder())
+      .addBack(LengthFieldPrepender())
+      .addBack(DecompressionDecoder())
+      .addBack(CompressionEncoder(options))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        if (!buf) {
+          failed++;
+          return;
+        }
+        msgs.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  std::vector<std::string> expected{"", "short", makeText(100000)};
+  for (const auto& msg : expected) {
+    pipeline->write(IOBuf::copyBuffer(msg));
+  }
+  EXPECT_EQ(expected, msgs);
+  EXPECT_EQ(0, failed);
+}
+
+TEST(DecompressionDecoder, Fail) {
+  if (!io::hasCodec(io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  auto pipeline =
+      Pipeline<std::unique_ptr<IOBuf>, std::unique_ptr<IOBuf>>::create();
+  int failed = 0;
+
+  DecompressionDecoder::Options options;
+  options.maxUncompressedLength = 1000;
+  (*pipeline)
+      .addBack(DecompressionDecoder(options))
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        EXPECT_EQ(nullptr, buf);
+        failed++;
+      }))
+      .finalize();
+
+  // Empty, an unknown type, corrupt data and too long.
+  pipeline->read(IOBuf::create(0));
+  pipeline->read(IOBuf::copyBuffer("\2abc"));
+  pipeline->read(IOBuf::copyBuffer("\1\5abcdef"));
+  pipeline->read(IOBuf::copyBuffer("\1\x80\x20" "abc"));
+  EXPECT_EQ(4, failed);
+}
+
+TEST(CompressionEncoder, Dictionary) {
+  if (!wangle::detail::kHaveZstdDictionaries) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  auto dictionary = makeText(2000);
+  std::vector<size_t> sizes;
+  for (bool useDictionary : {false, true}) {
+    BytesCapture capture;
+    auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+    CompressionEncoder::Options options;
+    if (useDictionary) {
+      options.dictionary = dictionary;
+    }
+    (*pipeline)
+        .addBack(&capture)
+        .addBack(CompressionEncoder(options))
+        .finalize();
+    pipeline->write(IOBuf::copyBuffer(dictionary.substr(500, 200)));
+    sizes.push_back(capture.written->computeChainDataLength());
+
+    if (useDictionary) {
+      DecompressionDecoder::Options decoderOptions;
+      decoderOptions.dictionary = dictionary;
+      DecompressionDecoder decoder(decoderOptions);
+      auto decoderPipeline =
+          Pipeline<std::unique_ptr<IOBuf>, std::unique_ptr<IOBuf>>::create();
+      std::string msg;
+      (*decoderPipeline)
+          .addBack(&decoder)
+          .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+            ASSERT_NE(nullptr, buf);
+            msg = buf->moveToFbString().toStdString();
+          }))
+          .finalize();
+      decoderPipeline->read(std::move(capture.written));
+      EXPECT_EQ(dictionary.substr(500, 200), msg);
+    }
+  }
+  // A message that is all in the dictionary compresses to very little.
+  EXPECT_LT(sizes[1], sizes[0] / 2);
+}
+
+TEST(CompressionEncoder, StreamingAdaptiveLevel) {
+  if (!io::hasStreamCodec(io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> msgs;
+
+  // A CPU budget no level meets, so the level drops every MiB and each
+  // drop starts a new stream.
+  CompressionEncoder::Options options;
+  options.mode = CompressionMode::STREAMING;
+  options.level = 3;
+  options.cpuNsPerByte = 1e-9;
+  options.minLevel = 1;
+  options.maxLevel = 3;
+  CompressionEncoder encoder(options);
+  EXPECT_EQ(3, encoder.getLevel());
+  (*pipeline)
+      .addBack(test::BytesReflector())
+      .addBack(StreamDecompressionDecoder())
+      .addBack(&encoder)
+      .addBack(LengthFieldBasedFrameDecoder())
+      .addBack(LengthFieldPrepender())
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        ASSERT_NE(nullptr, buf);
+        msgs.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  std::vector<std::string> expected;
+  for (int i = 0; i < 48; i++) {
+    expected.push_back(makeText(64 * 1024 + i));
+    pipeline->write(IOBuf::copyBuffer(expected.back()));
+  }
+  EXPECT_EQ(1, encoder.getLevel());
+  EXPECT_EQ(expected, msgs);
+}
+
+namespace {
+// Takes what is read if consume is set, and leaves it otherwise.
+class BytesRecorder : public wangle::InboundHandler<folly::IOBufQueue&> {
+ public:
+  explicit BytesRecorder(bool consume) : consume_(consume) {}
+
+  void read(Context*, folly::IOBufQueue& q) override {
+    maxLength = std::max(maxLength, q.chainLength());
+    if (consume_) {
+      bytes += q.chainLength();
+      q.move();
+    }
+  }
+
+  void readException(Context*, folly::exception_wrapper) override {
+    failed++;
+  }
+
+  size_t maxLength{0};
+  size_t bytes{0};
+  int failed{0};
+
+ private:
+  bool consume_;
+};
+} // namespace
+
+TEST(StreamDecompressionDecoder, MaxBufferedOutput) {
+  if (!io::hasStreamCodec(io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "folly built without zstd";
+  }
+  // 64 MiB of zeros compress to a few KiB.
+  const size_t length = 64 * 1024 * 1024;
+  const size_t limit = 1024 * 1024;
+  std::string zeros(length, '\0');
+  auto data = IOBuf::wrapBuffer(zeros.data(), zeros.size());
+  auto compressed = io::getCodec(io::CodecType::ZSTD)->compress(data.get());
+  EXPECT_LT(compressed->computeChainDataLength(), length / 1000);
+
+  // Passed on in bounded pieces while decompressing.
+  {
+    auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+    BytesRecorder recorder(true);
+    (*pipeline)
+        .addBack(StreamDecompressionDecoder(io::CodecType::ZSTD, limit))
+        .addBack(&recorder)
+        .finalize();
+    IOBufQueue q;
+    q.append(compressed->clone());
+    pipeline->read(q);
+    EXPECT_EQ(length, recorder.bytes);
+    EXPECT_LT(recorder.maxLength, 2 * limit);
+    EXPECT_EQ(0, recorder.failed);
+  }
+
+  // Fails if the next handler doesn't take it.
+  {
+    auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+    BytesRecorder recorder(false);
+    (*pipeline)
+        .addBack(StreamDecompressionDecoder(io::CodecType::ZSTD, limit))
+        .addBack(&recorder)
+        .finalize();
+    IOBufQueue q;
+    q.append(compressed->clone());
+    pipeline->read(q);
+    EXPECT_LT(recorder.maxLength, 2 * limit);
+    EXPECT_EQ(1, recorder.failed);
+    EXPECT_EQ(0, q.chainLength());
+  }
+}
+
+TEST(Crc32cFramePipeline, RoundTrip) {
+  auto pipeline = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> msgs;
+
+  (*pipeline)
+      .addBack(test::BytesReflector())
+      .addBack(LengthFieldBasedFrameDecoder())
+      .addBack(LengthFieldPrepender())
+      .addBack(Crc32cDecoder())
+      .addBack(Crc32cEncoder())
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        ASSERT_NE(nullptr, buf);
+        msgs.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  // A chain is checksummed in place, whether or not the last IOBuf has
+  // tailroom for the trailer.
+  auto chain = IOBuf::copyBuffer("hello, ");
+  chain->prependChain(IOBuf::copyBuffer("world", 0, 4));
+  pipeline->write(std::move(chain));
+  pipeline->write(IOBuf::create(0));
+  auto shared = IOBuf::copyBuffer("shared", 0, 4);
+  pipeline->write(shared->clone());
+  EXPECT_EQ((std::vector<std::string>{"hello, world", "", "shared"}), msgs);
+}
+
+TEST(Crc32cDecoder, Mismatch) {
+  BytesCapture capture;
+  auto encoder = Pipeline<IOBufQueue&, std::unique_ptr<IOBuf>>::create();
+  (*encoder).addBack(&capture).addBack(Crc32cEncoder()).finalize();
+  encoder->write(IOBuf::copyBuffer("hello"));
+  auto frame = capture.written->moveToFbString().toStdString();
+  ASSERT_EQ(9, frame.size());
+
+  auto pipeline =
+      Pipeline<std::unique_ptr<IOBuf>, std::unique_ptr<IOBuf>>::create();
+  std::vector<std::string> msgs;
+  int failed = 0;
+  (*pipeline)
+      .addBack(Crc32cDecoder())
+      .addBack(test::FrameTester([&](std::unique_ptr<IOBuf> buf) {
+        if (!buf) {
+          failed++;
+          return;
+        }
+        msgs.push_back(buf->moveToFbString().toStdString());
+      }))
+      .finalize();
+
+  pipeline->read(IOBuf::copyBuffer(frame));
+  EXPECT_EQ(std::vector<std::string>{"hello"}, msgs);
+
+  // A flipped bit in the message or the trailer, and a frame too short to
+  // have a trailer.
+  for (size_t i : {0, 8}) {
+    auto corrupt = frame;
+    corrupt[i] ^= 1;
+    pipeline->read(IOBuf::copyBuffer(corrupt));
+  }
+  pipeline->read(IOBuf::copyBuffer("abc"));
+  EXPECT_EQ(3, failed);
+  EXPECT_EQ(1, msgs.size());
+}
+
+namespace {
+class IOBufStringCollector : public InboundHandler<IOBufString> {
+ public:
+  void read(Context*, IOBufString msg) override {
+    msgs.push_back(std::move(msg));
+  }
+
+  std::vector<IOBufString> msgs;
+};
+} // namespace
+
+TEST(IOBufStringCodec, Read) {
+  IOBufStringCollector collector;
+  auto pipeline = Pipeline<std::unique_ptr<IOBuf>, std::string>::create();
+  (*pipeline).addBack(IOBufStringCodec()).addBack(&collector).finalize();
+
+  auto buf = IOBuf::copyBuffer("hello");
+  auto data = buf->data();
+  pipeline->read(std::move(buf));
+  auto chain = IOBuf::copyBuffer("hello, ");
+  chain->prependChain(IOBuf::copyBuffer("world"));
+  pipeline->read(std::move(chain));
+  ASSERT_EQ(2, collector.msgs.size());
+
+  // A single IOBuf is viewed in place.
+  auto& hello = collector.msgs[0];
+  ASSERT_TRUE(hello.isContiguous());
+  EXPECT_EQ("hello", hello.view());
+  EXPECT_EQ(reinterpret_cast<const char*>(data), hello.view().data());
+
+  auto& helloWorld = collector.msgs[1];
+  EXPECT_FALSE(helloWorld.isContiguous());
+  EXPECT_EQ(12, helloWorld.size());
+  EXPECT_EQ("hello, world", helloWorld.toString());
+  EXPECT_EQ("hello, ", helloWorld.cursor().readFixedString(7));
+  EXPECT_EQ("hello, world", helloWorld.coalesce());
+  EXPECT_TRUE(helloWorld.isContiguous());
+}
+
+TEST(IOBufStringCodec, Write) {
+  BytesCapture capture;
+  auto pipeline = Pipeline<std::unique_ptr<IOBuf>, std::string>::create();
+  (*pipeline).addBack(&capture).addBack(IOBufStringCodec()).finalize();
+
+  pipeline->write("short");
+  EXPECT_EQ("short", capture.written->moveToFbString().toStdString());
+
+  // Long strings are not copied.
+  std::string text(IOBufStringCodec::kMinOwnedLength, 'x');
+  auto data = text.data();
+  pipeline->write(std::move(text));
+  EXPECT_EQ(reinterpret_cast<const uint8_t*>(data), capture.written->data());
+  EXPECT_EQ(IOBufStringCodec::kMinOwnedLength, capture.written->length());
+}
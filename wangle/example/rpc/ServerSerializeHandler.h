@@ -17,6 +17,7 @@
 #pragma once
 
 #include <wangle/channel/Handler.h>
+#include <wangle/codec/LengthFieldPrepender.h>
 
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <thrift/test/gen-cpp2/ThriftTest.h>
@@ -40,6 +41,7 @@ class ServerSerializeHandler : public wangle::Handler<
       override {
     std::string out;
     apache::thrift::CompactSerializer::serialize(b, &out);
-    return ctx->fireWrite(folly::IOBuf::copyBuffer(out));
+    // Leave headroom for the LengthFieldPrepender to write the length into.
+    return ctx->fireWrite(wangle::LengthFieldPrepender::copyBuffer(out));
   }
 };
@@ -20,7 +20,7 @@
 #include <wangle/bootstrap/ServerBootstrap.h>
 #include <wangle/channel/AsyncSocketHandler.h>
 #include <wangle/codec/LineBasedFrameDecoder.h>
-#include <wangle/codec/StringCodec.h>
+#include <wangle/codec/IOBufStringCodec.h>
 
 using namespace folly;
 using namespace wangle;
@@ -29,17 +29,19 @@ DEFINE_int32(port, 23, "test telnet server port");
 
 using TelnetPipeline = Pipeline<IOBufQueue&, std::string>;
 
-class TelnetHandler : public HandlerAdapter<std::string> {
+class TelnetHandler : public HandlerAdapter<IOBufString, std::string> {
  public:
-  void read(Context* ctx, std::string msg) override {
-    if (msg.empty()) {
+  void read(Context* ctx, IOBufString msg) override {
+    // Lines are looked at where they were received, rather than copied.
+    auto line = msg.coalesce();
+    if (line.empty()) {
       write(ctx, "Please type something.\r\n");
-    } else if (msg == "bye") {
+    } else if (line == "bye") {
       write(ctx, "Have a fabulous day!\r\n").thenValue([ctx, this](auto&&) {
         close(ctx);
       });
     } else {
-      write(ctx, "Did you say '" + msg + "'?\r\n");
+      write(ctx, "Did you say '" + std::string(line) + "'?\r\n");
     }
   }
 
@@ -59,7 +61,7 @@ class TelnetPipelineFactory : public PipelineFactory<TelnetPipeline> {
     auto pipeline = TelnetPipeline::create();
     pipeline->addBack(AsyncSocketHandler(sock));
     pipeline->addBack(LineBasedFrameDecoder(8192));
-    pipeline->addBack(StringCodec());
+    pipeline->addBack(IOBufStringCodec());
     pipeline->addBack(TelnetHandler());
     pipeline->finalize();
 
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include <wangle/channel/Handler.h>
 #include <wangle/service/Service.h>
 
@@ -86,23 +88,78 @@ class PipelinedServerDispatcher : public HandlerAdapter<Req, Resp> {
  * by the pipeline.  Unlike a multiplexed client dispatcher, a
  * multiplexed server dispatcher needs no state, and the sequence id's
  * can just be copied from the request to the response in the pipeline.
+ *
+ * If maxInFlight is non-zero, reading from the transport is paused while
+ * that many requests are outstanding and resumed once one completes.
  */
 template <typename Req, typename Resp = Req>
 class MultiplexServerDispatcher : public HandlerAdapter<Req, Resp> {
  public:
   using Context = typename HandlerAdapter<Req, Resp>::Context;
 
-  explicit MultiplexServerDispatcher(Service<Req, Resp>* service)
-      : service_(service) {}
+  explicit MultiplexServerDispatcher(
+      Service<Req, Resp>* service,
+      size_t maxInFlight = 0)
+      : service_(service), maxInFlight_(maxInFlight) {
+    if (maxInFlight_) {
+      inFlight_ = std::make_shared<InFlight>();
+    }
+  }
 
   void read(Context* ctx, Req in) override {
-    (*service_)(std::move(in)).thenValue([ctx](Resp resp) {
+    if (maxInFlight_) {
+      acquireInFlight(ctx, 1);
+    }
+    dispatch(ctx, std::move(in));
+  }
+
+  // Accounts for the whole batch under one lock.
+  void readBatch(Context* ctx, ReadBatch<Req>& reqs) override {
+    if (maxInFlight_) {
+      acquireInFlight(ctx, reqs.size());
+    }
+    for (auto& req : reqs) {
+      dispatch(ctx, std::move(req));
+    }
+  }
+
+ private:
+  void acquireInFlight(Context* ctx, size_t n) {
+    // Responses may complete on other threads; the lock keeps the
+    // setReadEnabled() calls in the same order as the count changes.
+    std::lock_guard<std::mutex> g(inFlight_->mutex);
+    auto count = inFlight_->count;
+    inFlight_->count += n;
+    if (count < maxInFlight_ && inFlight_->count >= maxInFlight_) {
+      ctx->setReadEnabled(false);
+    }
+  }
+
+  void dispatch(Context* ctx, Req in) {
+    auto f = (*service_)(std::move(in)).thenValue([ctx](Resp resp) {
       ctx->fireWrite(std::move(resp));
     });
+    if (!maxInFlight_) {
+      return;
+    }
+    std::move(f).ensure([ctx, inFlight = inFlight_, max = maxInFlight_] {
+      // A batch may have taken the count past max, resume once it drops
+      // below.
+      std::lock_guard<std::mutex> g(inFlight->mutex);
+      if (inFlight->count-- == max) {
+        ctx->setReadEnabled(true);
+      }
+    });
   }
 
- private:
+  struct InFlight {
+    std::mutex mutex;
+    size_t count{0};
+  };
+
   Service<Req, Resp>* service_;
+  size_t maxInFlight_;
+  std::shared_ptr<InFlight> inFlight_;
 };
 
 } // namespace wangle